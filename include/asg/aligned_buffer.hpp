@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace asg {
+
+/// Alignment of all sample buffers: one cache line, enough for AVX-512.
+inline constexpr std::size_t simd_alignment = 64;
+
+/// Owning, fixed-size, cache-line-aligned array of trivially copyable
+/// elements. Contents are zero-initialised.
+template <typename T>
+class AlignedBuffer {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+    AlignedBuffer() noexcept = default;
+
+    explicit AlignedBuffer(std::size_t n) : size_(n)
+    {
+        if (n) {
+            data_ = static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{simd_alignment}));
+            std::fill_n(data_, n, T{});
+        }
+    }
+
+    AlignedBuffer(const AlignedBuffer& o) : AlignedBuffer(o.size_) { std::copy_n(o.data_, size_, data_); }
+    AlignedBuffer& operator=(const AlignedBuffer& o)
+    {
+        if (this != &o)
+            *this = AlignedBuffer(o);
+        return *this;
+    }
+    AlignedBuffer(AlignedBuffer&& o) noexcept
+        : data_(std::exchange(o.data_, nullptr)), size_(std::exchange(o.size_, 0))
+    {
+    }
+    AlignedBuffer& operator=(AlignedBuffer&& o) noexcept
+    {
+        if (this != &o) {
+            release();
+            data_ = std::exchange(o.data_, nullptr);
+            size_ = std::exchange(o.size_, 0);
+        }
+        return *this;
+    }
+    ~AlignedBuffer() { release(); }
+
+    T* data() noexcept { return data_; }
+    const T* data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    T& operator[](std::size_t i) noexcept { return data_[i]; }
+    const T& operator[](std::size_t i) const noexcept { return data_[i]; }
+
+    T* begin() noexcept { return data_; }
+    T* end() noexcept { return data_ + size_; }
+    const T* begin() const noexcept { return data_; }
+    const T* end() const noexcept { return data_ + size_; }
+
+    std::span<T> span() noexcept { return {data_, size_}; }
+    std::span<const T> span() const noexcept { return {data_, size_}; }
+
+private:
+    void release() noexcept
+    {
+        if (data_)
+            ::operator delete(data_, std::align_val_t{simd_alignment});
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    T* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+} // namespace asg
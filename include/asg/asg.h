@@ -0,0 +1,136 @@
+/* Stable C interface to the stimulus engine, for embedding in hosts that
+ * cannot use the C++ headers (MATLAB MEX, other language runtimes).
+ *
+ * All objects are opaque handles; all sample buffers belong to the caller
+ * and are written in place. No C++ exception crosses this interface: every
+ * fallible call returns an asg_status, and asg_last_error() describes the
+ * most recent failure on the calling thread.
+ *
+ * Real-time safety. Functions marked [RT] neither allocate, lock nor block
+ * and may be called from an audio callback. The others allocate or wait
+ * and belong on a control thread.
+ *
+ * Threading. asg_engine_render() is called from one audio thread and
+ * asg_engine_schedule() from one control thread (which may be the same
+ * thread); asg_render_token() and batch calls may come from any thread.
+ *
+ * ABI. Structs passed in carry their own size so fields can be appended
+ * in later versions; asg_token has a fixed layout. ASG_API_VERSION is
+ * bumped only for additions.
+ */
+#ifndef ASG_H
+#define ASG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* src/c_api.cpp defines ASG_BUILDING and exports the functions; hosts
+ * import them from the DLL, or define ASG_STATIC when linking the library
+ * statically. */
+#if defined(_WIN32) && defined(ASG_STATIC)
+#define ASG_API
+#elif defined(_WIN32) && defined(ASG_BUILDING)
+#define ASG_API __declspec(dllexport)
+#elif defined(_WIN32)
+#define ASG_API __declspec(dllimport)
+#else
+#define ASG_API __attribute__((visibility("default")))
+#endif
+
+#define ASG_API_VERSION 1
+
+typedef enum asg_status {
+    ASG_OK = 0,
+    ASG_ERROR_INVALID = -1,  /* bad argument or configuration */
+    ASG_ERROR_NO_MEMORY = -2,
+    ASG_ERROR_FULL = -3,     /* schedule queue full; retry later */
+    ASG_ERROR_INTERNAL = -4
+} asg_status;
+
+/* Built-in generators; see asg_token.params. */
+enum {
+    ASG_TONE = 0,     /* frequency Hz, peak amplitude, start phase (rad) */
+    ASG_NOISE = 1,    /* RMS; Gaussian */
+    ASG_HARMONIC = 2, /* f0 Hz, amplitude per component, lowest, highest harmonic */
+    ASG_SAM_NOISE = 3 /* RMS, modulation rate Hz, depth */
+};
+
+#define ASG_TOKEN_PARAMS 6
+
+/* A procedural stimulus: generator, seed and parameters, rendered on
+ * demand. 48 bytes, same layout on every platform. */
+typedef struct asg_token {
+    uint32_t generator;
+    uint32_t ramp;   /* raised-cosine onset/offset, samples */
+    uint64_t seed;
+    uint64_t length; /* samples */
+    float params[ASG_TOKEN_PARAMS];
+} asg_token;
+
+typedef struct asg_engine_config {
+    size_t struct_size;      /* sizeof(asg_engine_config) */
+    double sample_rate;      /* Hz, up to 1e6; 0 = 48000 */
+    uint32_t threads;        /* batch workers, up to 1024; 0 = one per CPU */
+    uint32_t max_voices;     /* concurrently playing tokens, up to 65536; 0 = 32 */
+    uint32_t max_block;      /* render scratch, samples, up to 2^20; 0 = 4096 */
+    uint32_t queue_capacity; /* pending schedule calls, up to 2^20; 0 = 256 */
+} asg_engine_config;
+
+typedef struct asg_engine asg_engine;
+typedef struct asg_batch asg_batch;
+
+ASG_API uint32_t asg_api_version(void);
+
+/* Message for the last failed call on this thread; never NULL. */
+ASG_API const char* asg_last_error(void);
+
+/* Engine: generators, a real-time token mixer and a batch worker pool.
+ * config may be NULL for defaults; zero fields take their default and
+ * any other out-of-range value fails with ASG_ERROR_INVALID. */
+ASG_API asg_status asg_engine_create(const asg_engine_config* config, asg_engine** engine);
+
+/* Waits for outstanding batches; NULL is ignored. */
+ASG_API void asg_engine_destroy(asg_engine* engine);
+
+/* [RT] Play `token` at absolute sample `at` with `gain` (negative
+ * inverts). Control thread; picked up by the next asg_engine_render(). */
+ASG_API asg_status asg_engine_schedule(asg_engine* engine, const asg_token* token, uint64_t at, float gain);
+
+/* [RT] Audio thread: write the next `frames` samples of the mix to `out`. */
+ASG_API asg_status asg_engine_render(asg_engine* engine, float* out, size_t frames);
+
+/* [RT] Sample clock: first sample of the next render. */
+ASG_API uint64_t asg_engine_position(const asg_engine* engine);
+
+/* [RT] Scheduled tokens that could not start (no free voice, or already
+ * over when picked up). */
+ASG_API uint64_t asg_engine_dropped(const asg_engine* engine);
+
+/* [RT] Samples [first, first + frames) of `token` into `out`. Any thread. */
+ASG_API asg_status asg_render_token(const asg_engine* engine, const asg_token* token, uint64_t first, float* out,
+                                    size_t frames);
+
+/* Render `count` tokens on the engine's pool: token i fills frames[i]
+ * samples of outputs[i]. Returns at once; the outputs must stay valid
+ * until the batch is done. */
+ASG_API asg_status asg_batch_submit(asg_engine* engine, const asg_token* tokens, float* const* outputs,
+                                    const size_t* frames, size_t count, asg_batch** batch);
+
+/* [RT] Nonzero once every output is written. */
+ASG_API int asg_batch_done(const asg_batch* batch);
+
+/* Block until the batch is done. */
+ASG_API asg_status asg_batch_wait(asg_batch* batch);
+
+/* Wait for the batch if needed and free the handle; NULL is ignored. */
+ASG_API void asg_batch_release(asg_batch* batch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ASG_H */
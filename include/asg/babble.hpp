@@ -0,0 +1,177 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+#include <asg/rng.hpp>
+#include <asg/thread_pool.hpp>
+#include <asg/wav.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+
+namespace asg {
+
+/// A set of memory-mapped mono speech recordings with their RMS levels.
+///
+/// Files stay mapped for the corpus' lifetime and are only paged in where
+/// they are read. RMS is computed once at load (in parallel if a pool is
+/// given) unless the caller supplies it, e.g. from a previous run.
+class SpeechCorpus {
+public:
+    struct Entry {
+        std::string path;
+        double rms = 0.0; ///< <= 0: compute on load
+    };
+
+    explicit SpeechCorpus(const std::vector<Entry>& entries, ThreadPool* pool = nullptr)
+    {
+        if (entries.empty())
+            throw std::invalid_argument("SpeechCorpus: no files");
+        files_.reserve(entries.size());
+        rms_.resize(entries.size());
+        for (const Entry& e : entries) {
+            auto& f = files_.emplace_back(std::make_unique<MappedWav>(e.path));
+            if (f->frames() == 0)
+                throw std::runtime_error("SpeechCorpus: empty file: " + e.path);
+            if (f->sample_rate() != files_.front()->sample_rate())
+                throw std::runtime_error("SpeechCorpus: mixed sample rates: " + e.path);
+            // Talkers read in long sequential runs (and measure_rms streams
+            // the whole file), so keep readahead on.
+            f->advise(MADV_SEQUENTIAL);
+        }
+        const auto measure = [&](std::size_t i) {
+            rms_[i] = entries[i].rms > 0.0 ? entries[i].rms : measure_rms(*files_[i]);
+            if (!(rms_[i] > 0.0))
+                throw std::runtime_error("SpeechCorpus: silent file: " + entries[i].path);
+        };
+        if (pool)
+            pool->parallel_for(entries.size(), measure);
+        else
+            for (std::size_t i = 0; i < entries.size(); ++i)
+                measure(i);
+    }
+
+    std::size_t size() const noexcept { return files_.size(); }
+    double sample_rate() const noexcept { return files_.front()->sample_rate(); }
+    const MappedWav& file(std::size_t i) const noexcept { return *files_[i]; }
+    double rms(std::size_t i) const noexcept { return rms_[i]; }
+
+    /// Channel-0 RMS of a whole file, read in chunks.
+    static double measure_rms(const MappedWav& wav)
+    {
+        constexpr std::size_t chunk = 16384;
+        AlignedBuffer<float> buf(chunk);
+        double sum = 0.0;
+        for (std::size_t first = 0; first < wav.frames(); first += chunk) {
+            const std::size_t n = std::min(chunk, wav.frames() - first);
+            wav.read(0, first, buf.data(), n);
+            float acc = 0.0f;
+            for (std::size_t i = 0; i < n; ++i)
+                acc += buf[i] * buf[i];
+            sum += acc;
+        }
+        return std::sqrt(sum / static_cast<double>(wav.frames()));
+    }
+
+private:
+    std::vector<std::unique_ptr<MappedWav>> files_;
+    std::vector<double> rms_;
+};
+
+/// Multi-talker babble streamed from a SpeechCorpus.
+///
+/// Each talker plays a randomly chosen file from a random offset; when it
+/// reaches the end it continues with another random file from the start.
+/// Every talker is normalised to `level` RMS using the corpus' precomputed
+/// RMS and the sum is scaled by 1/sqrt(talkers), so the babble has the
+/// requested RMS on average whatever the talker count.
+///
+/// Rendering reads only the next `chunk` samples of each talker from the
+/// mapping into one scratch buffer and accumulates them into the output
+/// with a vectorised multiply-add; no talker's signal is ever held whole.
+/// Choices are drawn from a counter RNG per talker, so the babble is a
+/// function of the seed alone.
+class BabbleGenerator {
+public:
+    struct Config {
+        std::size_t talkers = 8;
+        float level = 0.1f;        ///< RMS of the mixture
+        std::uint64_t seed = 1;
+        std::size_t chunk = 1024;  ///< samples read per talker per step
+    };
+
+    BabbleGenerator(const SpeechCorpus& corpus, const Config& cfg)
+        : corpus_(corpus), cfg_(cfg), rng_(cfg.seed), talkers_(cfg.talkers), scratch_(cfg.chunk),
+          gain_(corpus.size())
+    {
+        if (cfg.talkers == 0 || cfg.chunk == 0)
+            throw std::invalid_argument("BabbleGenerator: need talkers and a chunk size");
+        const double mix = cfg.level / std::sqrt(static_cast<double>(cfg.talkers));
+        for (std::size_t f = 0; f < corpus.size(); ++f)
+            gain_[f] = static_cast<float>(mix / corpus.rms(f));
+        for (std::size_t t = 0; t < talkers_.size(); ++t) {
+            Talker& tk = talkers_[t];
+            tk.rng = rng_.stream(t);
+            next_file(tk);
+            tk.pos = static_cast<std::size_t>(tk.rng.bits(tk.draws++) % corpus_.file(tk.file).frames());
+        }
+    }
+
+    std::size_t talkers() const noexcept { return talkers_.size(); }
+
+    /// Write the next `frames` samples of babble.
+    void render(float* out, std::size_t frames) noexcept
+    {
+        std::fill(out, out + frames, 0.0f);
+        for (Talker& tk : talkers_) {
+            std::size_t done = 0;
+            while (done < frames) {
+                const MappedWav& wav = corpus_.file(tk.file);
+                const std::size_t n = std::min({frames - done, cfg_.chunk, wav.frames() - tk.pos});
+                wav.read(0, tk.pos, scratch_.data(), n);
+                mix_into(out + done, scratch_.data(), gain_[tk.file], n);
+                done += n;
+                tk.pos += n;
+                if (tk.pos == wav.frames()) {
+                    next_file(tk);
+                    tk.pos = 0;
+                }
+            }
+        }
+    }
+
+private:
+    struct Talker {
+        CounterRng rng{0};
+        std::uint64_t draws = 0;
+        std::size_t file = 0;
+        std::size_t pos = 0;
+    };
+
+    void next_file(Talker& tk) noexcept
+    {
+        tk.file = static_cast<std::size_t>(tk.rng.bits(tk.draws++) % corpus_.size());
+    }
+
+    static void mix_into(float* __restrict out, const float* __restrict in, float g, std::size_t n) noexcept
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] += g * in[i];
+    }
+
+    const SpeechCorpus& corpus_;
+    Config cfg_;
+    CounterRng rng_;
+    std::vector<Talker> talkers_;
+    AlignedBuffer<float> scratch_;
+    std::vector<float> gain_;
+};
+
+} // namespace asg
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <asg/huge_buffer.hpp>
+#include <asg/numa.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace asg {
+
+/// Renders many independent jobs into one large output buffer.
+///
+/// The output is a single HugeBuffer laid out node by node: jobs are split
+/// into one contiguous range per NUMA node (balanced by frame count and
+/// the node's share of worker threads), each range starts on a huge-page
+/// boundary, and only threads pinned to that node render into it. Since
+/// the buffer is never touched before rendering, first-touch places every
+/// page on the node that produced it, and later per-node passes over the
+/// output stay local.
+class BatchRenderer {
+public:
+    struct Config {
+        HugePages huge_pages = HugePages::transparent;
+        bool numa = true;        ///< pin workers to nodes and place output per node
+        std::size_t threads = 0; ///< 0 = one per online CPU
+    };
+
+    /// Rendered output. Job i occupies job(i); jobs are 64-byte aligned.
+    class Result {
+    public:
+        std::size_t jobs() const noexcept { return offsets_.size(); }
+        std::span<float> job(std::size_t i) noexcept { return {buffer_.data() + offsets_[i], frames_[i]}; }
+        std::span<const float> job(std::size_t i) const noexcept { return {buffer_.data() + offsets_[i], frames_[i]}; }
+        HugePages huge_pages() const noexcept { return buffer_.policy(); }
+
+    private:
+        friend class BatchRenderer;
+        HugeBuffer<float> buffer_;
+        std::vector<std::size_t> offsets_;
+        std::vector<std::size_t> frames_;
+    };
+
+    BatchRenderer() : BatchRenderer(Config{}) {}
+
+    explicit BatchRenderer(const Config& cfg) : cfg_(cfg), topology_(NumaTopology::detect())
+    {
+        if (!cfg.numa) {
+            std::vector<int> all;
+            for (const auto& cpus : topology_.nodes)
+                all.insert(all.end(), cpus.begin(), cpus.end());
+            topology_.nodes = {std::move(all)};
+        }
+    }
+
+    const NumaTopology& topology() const noexcept { return topology_; }
+
+    /// Render job i by calling fn(i, out) with out.size() == job_frames[i].
+    /// fn runs concurrently on worker threads. The first exception thrown
+    /// is rethrown once all workers have stopped.
+    template <typename Fn>
+    Result render(std::span<const std::size_t> job_frames, Fn&& fn) const
+    {
+        const std::size_t nodes = topology_.nodes.size();
+        const std::size_t threads = cfg_.threads ? cfg_.threads : std::max<std::size_t>(1, topology_.cpu_count());
+
+        // Threads per node, round-robin over nodes.
+        std::vector<std::size_t> node_threads(nodes, 0);
+        for (std::size_t t = 0; t < threads; ++t)
+            ++node_threads[t % nodes];
+        std::size_t last_active = 0;
+        for (std::size_t n = 0; n < nodes; ++n)
+            if (node_threads[n])
+                last_active = n;
+
+        // Contiguous job range per node, balanced by frames.
+        std::size_t total = 0;
+        for (std::size_t f : job_frames)
+            total += f;
+        std::vector<std::size_t> node_begin(nodes + 1, job_frames.size());
+        node_begin[0] = 0;
+        {
+            std::size_t job = 0, acc = 0, share = 0;
+            for (std::size_t n = 0; n < nodes; ++n) {
+                share += node_threads[n];
+                const std::size_t target = total / threads * share + total % threads * share / threads;
+                while (job < job_frames.size() && (acc < target || n == last_active)) {
+                    acc += job_frames[job];
+                    ++job;
+                }
+                node_begin[n + 1] = job;
+            }
+        }
+
+        // Layout: 64-byte aligned jobs; node ranges on huge-page boundaries.
+        Result result;
+        result.offsets_.resize(job_frames.size());
+        result.frames_.assign(job_frames.begin(), job_frames.end());
+        constexpr std::size_t page_floats = HugeBuffer<float>::huge_page / sizeof(float);
+        std::size_t offset = 0;
+        for (std::size_t n = 0; n < nodes; ++n) {
+            offset = (offset + page_floats - 1) / page_floats * page_floats;
+            for (std::size_t j = node_begin[n]; j < node_begin[n + 1]; ++j) {
+                result.offsets_[j] = offset;
+                offset += (job_frames[j] + 15) & ~std::size_t(15);
+            }
+        }
+        result.buffer_ = HugeBuffer<float>(offset, cfg_.huge_pages);
+
+        std::vector<std::atomic<std::size_t>> next(nodes);
+        for (std::size_t n = 0; n < nodes; ++n)
+            next[n].store(node_begin[n], std::memory_order_relaxed);
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for (std::size_t n = 0; n < nodes; ++n) {
+            for (std::size_t t = 0; t < node_threads[n]; ++t) {
+                workers.emplace_back([&, n] {
+                    if (cfg_.numa)
+                        pin_current_thread(topology_.nodes[n]);
+                    for (std::size_t j; (j = next[n].fetch_add(1, std::memory_order_relaxed)) < node_begin[n + 1];) {
+                        try {
+                            fn(j, result.job(j));
+                        } catch (...) {
+                            std::lock_guard lock(error_mutex);
+                            if (!error)
+                                error = std::current_exception();
+                        }
+                    }
+                });
+            }
+        }
+        for (auto& w : workers)
+            w.join();
+        if (error)
+            std::rethrow_exception(error);
+        return result;
+    }
+
+private:
+    Config cfg_;
+    NumaTopology topology_;
+};
+
+} // namespace asg
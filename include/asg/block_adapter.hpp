@@ -0,0 +1,136 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace asg {
+
+/// A mono generator: render(out, frames) writes the next `frames` samples.
+template <typename S>
+concept MonoSource = requires(S& s, float* out, std::size_t n) { s.render(out, n); };
+
+/// A planar multi-channel generator: render(channels, frames).
+template <typename S>
+concept PlanarSource = requires(S& s, float* const* out, std::size_t n) { s.render(out, n); };
+
+/// Presents a source that is always driven in fixed, aligned sub-blocks
+/// as one that accepts any frame count.
+///
+/// Output depends only on the stream position, never on how callers
+/// partition it: the source sees the same sequence of `block`-sized calls
+/// (on the same grid, into 64-byte aligned memory) whatever the callback
+/// sizes are. When a call ends inside a sub-block, the whole sub-block is
+/// rendered ahead and its remainder is returned by the next call; since
+/// generators do not consume input, this adds no latency.
+///
+/// Whole sub-blocks are rendered straight into the caller's buffers when
+/// those are aligned, and through an internal buffer otherwise.
+template <typename Source>
+    requires MonoSource<Source> || PlanarSource<Source>
+class BlockAdapter {
+public:
+    static constexpr bool planar = PlanarSource<Source>;
+
+    BlockAdapter(Source& source, std::size_t block, std::size_t channels = 1)
+        : source_(source), block_(block), channels_(planar ? channels : 1),
+          buffer_(block * (planar ? channels : 1)), ptrs_(channels_), pos_(block)
+    {
+        if (block == 0 || block % (simd_alignment / sizeof(float)) != 0)
+            throw std::invalid_argument("BlockAdapter: block must be a positive multiple of 16 frames");
+        if (channels_ == 0)
+            throw std::invalid_argument("BlockAdapter: need at least one channel");
+    }
+
+    std::size_t block() const noexcept { return block_; }
+    std::size_t channels() const noexcept { return channels_; }
+
+    /// Frames rendered ahead and not yet returned.
+    std::size_t pending() const noexcept { return block_ - pos_; }
+
+    /// Mono sources only.
+    void render(float* out, std::size_t frames)
+        requires(!planar)
+    {
+        render(&out, frames);
+    }
+
+    /// `out` holds channels() planar channel pointers.
+    void render(float* const* out, std::size_t frames)
+    {
+        std::size_t done = 0;
+
+        // Remainder of the sub-block rendered ahead by the previous call.
+        if (pos_ < block_) {
+            const std::size_t n = std::min(frames, block_ - pos_);
+            copy_out(out, done, pos_, n);
+            pos_ += n;
+            done += n;
+        }
+
+        // Whole sub-blocks.
+        while (frames - done >= block_) {
+            if (aligned(out, done)) {
+                for (std::size_t c = 0; c < channels_; ++c)
+                    ptrs_[c] = out[c] + done;
+                call_source(ptrs_.data());
+            } else {
+                render_internal();
+                copy_out(out, done, 0, block_);
+            }
+            done += block_;
+        }
+
+        // Partial tail: render one sub-block ahead.
+        if (done < frames) {
+            render_internal();
+            pos_ = frames - done;
+            copy_out(out, done, 0, pos_);
+        }
+    }
+
+private:
+    bool aligned(float* const* out, std::size_t offset) const noexcept
+    {
+        for (std::size_t c = 0; c < channels_; ++c)
+            if (reinterpret_cast<std::uintptr_t>(out[c] + offset) % simd_alignment != 0)
+                return false;
+        return true;
+    }
+
+    void call_source(float* const* ch)
+    {
+        if constexpr (planar)
+            source_.render(ch, block_);
+        else
+            source_.render(ch[0], block_);
+    }
+
+    void render_internal()
+    {
+        for (std::size_t c = 0; c < channels_; ++c)
+            ptrs_[c] = buffer_.data() + c * block_;
+        call_source(ptrs_.data());
+    }
+
+    void copy_out(float* const* out, std::size_t out_offset, std::size_t buf_offset, std::size_t n) noexcept
+    {
+        for (std::size_t c = 0; c < channels_; ++c)
+            std::memcpy(out[c] + out_offset, buffer_.data() + c * block_ + buf_offset, n * sizeof(float));
+    }
+
+    Source& source_;
+    std::size_t block_;
+    std::size_t channels_;
+    AlignedBuffer<float> buffer_;
+    std::vector<float*> ptrs_;
+    std::size_t pos_;
+};
+
+} // namespace asg
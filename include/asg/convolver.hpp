@@ -0,0 +1,194 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+#include <asg/fft.hpp>
+#include <asg/spsc_queue.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace asg {
+
+/// Uniformly partitioned overlap-save convolver with glitch-free IR
+/// updates.
+///
+/// The impulse response is split into `block`-sized partitions whose
+/// spectra (FFT size 2 * block) are multiplied against a frequency-domain
+/// delay line of past input spectra, so each block costs one forward FFT,
+/// one inverse FFT and a complex multiply-accumulate over the partitions,
+/// with no latency beyond the block itself. Spectra are stored as split
+/// real/imaginary arrays so the accumulation vectorises.
+///
+/// IRs are exchanged through a small pool of spectrum slots, the same
+/// free/full queue pattern DuplexEngine uses for capture blocks: set_ir()
+/// (control thread; runs the partition FFTs) fills a free slot and queues
+/// it, and process() (audio thread) picks it up, renders one block with
+/// both the old and the new IR crossfaded, and returns the old slot.
+class PartitionedConvolver {
+public:
+    struct Config {
+        std::size_t block = 256;     ///< power of two
+        std::size_t max_ir = 48000;  ///< longest IR in samples
+        std::size_t slots = 3;       ///< IR updates that may be in flight, plus one
+    };
+
+    explicit PartitionedConvolver(const Config& cfg)
+        : cfg_(cfg),
+          bins_(cfg.block + 1),
+          partitions_((cfg.max_ir + cfg.block - 1) / cfg.block),
+          plan_(2 * cfg.block),
+          control_plan_(2 * cfg.block),
+          input_(2 * cfg.block),
+          time_(2 * cfg.block),
+          spec_(bins_),
+          fdl_re_(partitions_ * bins_),
+          fdl_im_(partitions_ * bins_),
+          acc_re_(bins_),
+          acc_im_(bins_),
+          out_new_(cfg.block),
+          slots_(std::max<std::size_t>(cfg.slots, 2)),
+          free_(slots_.size()),
+          full_(slots_.size()),
+          control_time_(2 * cfg.block),
+          control_spec_(bins_)
+    {
+        if (cfg.block < 16 || (cfg.block & (cfg.block - 1)) != 0 || cfg.max_ir == 0)
+            throw std::invalid_argument("PartitionedConvolver: block must be a power of two >= 16");
+        for (Slot& s : slots_) {
+            s.re = AlignedBuffer<float>(partitions_ * bins_);
+            s.im = AlignedBuffer<float>(partitions_ * bins_);
+        }
+        current_ = &slots_[0];
+        for (std::size_t i = 1; i < slots_.size(); ++i)
+            free_.try_push(&slots_[i]);
+    }
+
+    std::size_t block() const noexcept { return cfg_.block; }
+    std::size_t max_ir() const noexcept { return partitions_ * cfg_.block; }
+
+    /// Control thread: install a new IR (truncated to max_ir()). Returns
+    /// false if every slot is still in flight; try again after the audio
+    /// thread has processed a block.
+    bool set_ir(std::span<const float> ir)
+    {
+        Slot* s = nullptr;
+        if (auto p = free_.try_pop())
+            s = *p;
+        else
+            return false;
+        const std::size_t B = cfg_.block;
+        const std::size_t len = std::min(ir.size(), max_ir());
+        s->active = (len + B - 1) / B;
+        for (std::size_t p = 0; p < s->active; ++p) {
+            const std::size_t n = std::min(B, len - p * B);
+            std::fill(control_time_.begin(), control_time_.end(), 0.0f);
+            std::memcpy(control_time_.data(), ir.data() + p * B, n * sizeof(float));
+            control_plan_.forward(control_time_.data(), control_spec_.data());
+            for (std::size_t k = 0; k < bins_; ++k) {
+                s->re[p * bins_ + k] = control_spec_[k].real();
+                s->im[p * bins_ + k] = control_spec_[k].imag();
+            }
+        }
+        full_.try_push(s);
+        return true;
+    }
+
+    /// Audio thread: convolve exactly block() samples. `in` and `out` may
+    /// alias.
+    void process(const float* in, float* out) noexcept
+    {
+        const std::size_t B = cfg_.block;
+        std::memmove(input_.data(), input_.data() + B, B * sizeof(float));
+        std::memcpy(input_.data() + B, in, B * sizeof(float));
+        plan_.forward(input_.data(), spec_.data());
+        head_ = head_ == 0 ? partitions_ - 1 : head_ - 1;
+        float* __restrict xr = fdl_re_.data() + head_ * bins_;
+        float* __restrict xi = fdl_im_.data() + head_ * bins_;
+        for (std::size_t k = 0; k < bins_; ++k) {
+            xr[k] = spec_[k].real();
+            xi[k] = spec_[k].imag();
+        }
+
+        Slot* next = nullptr;
+        if (Slot** p = full_.front()) {
+            next = *p;
+            full_.pop();
+        }
+
+        convolve(*current_, out);
+        if (next) {
+            convolve(*next, out_new_.data());
+            // Linear crossfade over the block; both IRs saw the same input
+            // history, so there is no transient.
+            const float step = 1.0f / static_cast<float>(B);
+            for (std::size_t i = 0; i < B; ++i) {
+                const float g = (static_cast<float>(i) + 0.5f) * step;
+                out[i] += g * (out_new_[i] - out[i]);
+            }
+            free_.try_push(current_);
+            current_ = next;
+        }
+    }
+
+    /// Audio thread: clear the input history.
+    void reset() noexcept
+    {
+        std::fill(input_.begin(), input_.end(), 0.0f);
+        std::fill(fdl_re_.begin(), fdl_re_.end(), 0.0f);
+        std::fill(fdl_im_.begin(), fdl_im_.end(), 0.0f);
+    }
+
+private:
+    struct Slot {
+        AlignedBuffer<float> re, im;
+        std::size_t active = 0; ///< non-zero partitions
+    };
+
+    void convolve(const Slot& h, float* out) noexcept
+    {
+        float* __restrict ar = acc_re_.data();
+        float* __restrict ai = acc_im_.data();
+        std::fill(ar, ar + bins_, 0.0f);
+        std::fill(ai, ai + bins_, 0.0f);
+        for (std::size_t p = 0; p < h.active; ++p) {
+            const std::size_t d = (head_ + p) % partitions_;
+            const float* __restrict xr = fdl_re_.data() + d * bins_;
+            const float* __restrict xi = fdl_im_.data() + d * bins_;
+            const float* __restrict hr = h.re.data() + p * bins_;
+            const float* __restrict hi = h.im.data() + p * bins_;
+            for (std::size_t k = 0; k < bins_; ++k) {
+                ar[k] += xr[k] * hr[k] - xi[k] * hi[k];
+                ai[k] += xr[k] * hi[k] + xi[k] * hr[k];
+            }
+        }
+        for (std::size_t k = 0; k < bins_; ++k)
+            spec_[k] = cfloat(ar[k], ai[k]);
+        plan_.inverse(spec_.data(), time_.data());
+        // Overlap-save: the second half is the valid linear convolution.
+        std::memcpy(out, time_.data() + cfg_.block, cfg_.block * sizeof(float));
+    }
+
+    Config cfg_;
+    std::size_t bins_;
+    std::size_t partitions_;
+    FftPlan plan_;
+    FftPlan control_plan_;
+    AlignedBuffer<float> input_, time_;
+    AlignedBuffer<cfloat> spec_;
+    AlignedBuffer<float> fdl_re_, fdl_im_, acc_re_, acc_im_, out_new_;
+    std::size_t head_ = 0;
+
+    std::vector<Slot> slots_;
+    Slot* current_ = nullptr;
+    SpscQueue<Slot*> free_;
+    SpscQueue<Slot*> full_;
+
+    AlignedBuffer<float> control_time_;
+    AlignedBuffer<cfloat> control_spec_;
+};
+
+} // namespace asg
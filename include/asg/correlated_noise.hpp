@@ -0,0 +1,139 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+#include <asg/rng.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace asg {
+
+/// Multi-channel Gaussian noise with controlled inter-channel correlation.
+///
+/// Each channel c is a mix of one shared component S and its own
+/// independent component N_c:
+///
+///     x_c = sign(rho_c) * sqrt(|rho_c|) * S + sqrt(1 - |rho_c|) * N_c
+///
+/// so every channel has unit variance (times `rms`) and the correlation
+/// between channels c and d is sign(rho_c * rho_d) * sqrt(|rho_c * rho_d|).
+/// Two channels with the same rho therefore correlate at |rho|; use
+/// set_pair_correlation() for a signed interaural target (e.g. N0 = 1,
+/// Npi = -1, Nu = 0).
+///
+/// S and every N_c come from their own counter-based RNG stream indexed by
+/// absolute sample position, so output is reproducible from (seed,
+/// position) alone and independent of block size. Correlation changes made
+/// while running are ramped linearly across the next render() call.
+class CorrelatedNoise {
+public:
+    struct Config {
+        std::size_t channels = 2;
+        float rms = 1.0f;
+        std::uint64_t seed = 0;
+    };
+
+    explicit CorrelatedNoise(const Config& cfg)
+        : cfg_(cfg),
+          rng_(cfg.seed),
+          target_(cfg.channels),
+          shared_w_(cfg.channels, 0.0f),
+          indep_w_(cfg.channels, cfg.rms),
+          next_shared_(cfg.channels),
+          next_indep_(cfg.channels),
+          shared_(scratch_frames),
+          indep_(scratch_frames)
+    {
+        if (cfg.channels == 0)
+            throw std::invalid_argument("CorrelatedNoise: need at least one channel");
+        for (auto& t : target_)
+            t.store(0.0f, std::memory_order_relaxed);
+    }
+
+    std::size_t channels() const noexcept { return cfg_.channels; }
+    std::uint64_t position() const noexcept { return pos_; }
+    void seek(std::uint64_t sample) noexcept { pos_ = sample; }
+
+    /// Weight of the shared component, in [-1, 1]. Safe to call from any
+    /// thread while rendering.
+    void set_correlation(std::size_t channel, float rho) noexcept
+    {
+        target_[channel].store(std::clamp(rho, -1.0f, 1.0f), std::memory_order_relaxed);
+    }
+
+    /// Set channels a and b to correlate at `r` in [-1, 1].
+    void set_pair_correlation(std::size_t a, std::size_t b, float r) noexcept
+    {
+        set_correlation(a, std::fabs(r));
+        set_correlation(b, r);
+    }
+
+    /// Render `frames` samples into each of channels() planar buffers.
+    void render(float* const* out, std::size_t frames) noexcept
+    {
+        const CounterRng shared_rng = rng_.stream(0);
+        const std::size_t nch = cfg_.channels;
+
+        // Per-call linear ramp from the current to the target weights.
+        for (std::size_t c = 0; c < nch; ++c) {
+            const float rho = target_[c].load(std::memory_order_relaxed);
+            next_shared_[c] = std::copysign(std::sqrt(std::fabs(rho)), rho) * cfg_.rms;
+            next_indep_[c] = std::sqrt(1.0f - std::fabs(rho)) * cfg_.rms;
+        }
+        // Settings made before the first render apply from sample 0, so the
+        // output does not depend on the size of the first call.
+        if (!started_) {
+            shared_w_ = next_shared_;
+            indep_w_ = next_indep_;
+            started_ = frames > 0;
+        }
+        const float inv = frames ? 1.0f / static_cast<float>(frames) : 0.0f;
+
+        for (std::size_t done = 0; done < frames;) {
+            const std::size_t n = std::min(scratch_frames, frames - done);
+            float* s = shared_.data();
+            float* r = indep_.data();
+            shared_rng.fill_normal(s, n, pos_ + done);
+
+            for (std::size_t c = 0; c < nch; ++c) {
+                rng_.stream(c + 1).fill_normal(r, n, pos_ + done);
+                float* y = out[c] + done;
+                const float da = (next_shared_[c] - shared_w_[c]) * inv;
+                const float db = (next_indep_[c] - indep_w_[c]) * inv;
+                const float a0 = shared_w_[c] + da * static_cast<float>(done);
+                const float b0 = indep_w_[c] + db * static_cast<float>(done);
+                for (std::size_t i = 0; i < n; ++i) {
+                    const float fi = static_cast<float>(i);
+                    y[i] = (a0 + da * fi) * s[i] + (b0 + db * fi) * r[i];
+                }
+            }
+            done += n;
+        }
+
+        shared_w_.swap(next_shared_);
+        indep_w_.swap(next_indep_);
+        pos_ += frames;
+    }
+
+private:
+    static constexpr std::size_t scratch_frames = 256;
+
+    Config cfg_;
+    CounterRng rng_;
+    std::vector<std::atomic<float>> target_;
+    std::vector<float> shared_w_;
+    std::vector<float> indep_w_;
+    std::vector<float> next_shared_;
+    std::vector<float> next_indep_;
+    AlignedBuffer<float> shared_;
+    AlignedBuffer<float> indep_;
+    std::uint64_t pos_ = 0;
+    bool started_ = false;
+};
+
+} // namespace asg
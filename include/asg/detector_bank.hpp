@@ -0,0 +1,191 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+#include <asg/triple_buffer.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace asg {
+
+/// Per-frequency output of a DetectorBank.
+struct DetectorReading {
+    double frequency = 0.0;
+    float amplitude = 0.0f;      ///< of the averaged response, input units (peak)
+    float phase = 0.0f;          ///< radians, relative to the stimulus clock
+    float noise = 0.0f;          ///< noise floor of the averaged estimate, same units
+    float snr_db = 0.0f;
+    std::uint64_t windows = 0;   ///< analysis windows averaged so far
+};
+
+/// Bank of Goertzel detectors with lock-in style coherent averaging, for
+/// tracking DPOAE/ASSR components at known frequencies.
+///
+/// Input is analysed in consecutive windows of `window` samples. Within a
+/// window each frequency runs a Goertzel recursion; all frequencies are
+/// stored as structure-of-arrays and updated in one inner loop, which the
+/// compiler vectorises across frequencies. At the end of a window the
+/// complex estimate is rotated to the stimulus clock (the absolute sample
+/// position of the window start), so phase is referenced to stimulus
+/// onset just as with a lock-in amplifier, and successive windows average
+/// coherently.
+///
+/// The running average is exponential with a memory of `averages`
+/// windows (a plain mean until that many have been seen). The noise floor
+/// is estimated from the scatter of the per-window estimates around that
+/// mean, so it needs no extra noise bins.
+///
+/// process() runs inline on captured input without allocating; readings()
+/// may be called concurrently from one control thread and never blocks.
+class DetectorBank {
+public:
+    struct Config {
+        double sample_rate = 48000.0;
+        std::vector<double> frequencies;
+        std::size_t window = 4800;
+        std::size_t averages = 16;
+    };
+
+    explicit DetectorBank(const Config& cfg)
+        : cfg_(cfg),
+          n_(cfg.frequencies.size()),
+          coeff_(n_), s1_(n_), s2_(n_),
+          mean_(n_), var_(n_),
+          results_(std::vector<DetectorReading>(n_))
+    {
+        if (n_ == 0 || cfg.window == 0 || cfg.averages == 0)
+            throw std::invalid_argument("DetectorBank: need frequencies, window and averages");
+        omega_.resize(n_);
+        for (std::size_t k = 0; k < n_; ++k) {
+            if (cfg.frequencies[k] <= 0.0 || cfg.frequencies[k] >= cfg.sample_rate / 2)
+                throw std::invalid_argument("DetectorBank: frequency out of range");
+            omega_[k] = two_pi * cfg.frequencies[k] / cfg.sample_rate;
+            coeff_[k] = static_cast<float>(2.0 * std::cos(omega_[k]));
+        }
+    }
+
+    std::size_t size() const noexcept { return n_; }
+
+    /// Analyse `frames` samples whose first sample is at stimulus-clock
+    /// position `first_sample` (e.g. a CaptureBlock's stamp). Gaps in the
+    /// stamps restart the current window.
+    void process(const float* x, std::size_t frames, std::uint64_t first_sample) noexcept
+    {
+        if (filled_ > 0 && first_sample != window_start_ + filled_)
+            restart_window();
+        while (frames > 0) {
+            if (filled_ == 0)
+                window_start_ = first_sample;
+            const std::size_t n = std::min(frames, cfg_.window - filled_);
+            run(x, n);
+            filled_ += n;
+            x += n;
+            frames -= n;
+            first_sample += n;
+            if (filled_ == cfg_.window)
+                finish_window();
+        }
+    }
+
+    /// Latest readings; valid until the next call on the same thread.
+    const std::vector<DetectorReading>& readings() noexcept
+    {
+        results_.update();
+        return results_.front();
+    }
+
+    /// Forget the running averages.
+    void reset() noexcept
+    {
+        restart_window();
+        std::fill(mean_.begin(), mean_.end(), std::complex<double>{});
+        std::fill(var_.begin(), var_.end(), 0.0);
+        windows_ = 0;
+    }
+
+private:
+    void run(const float* x, std::size_t frames) noexcept
+    {
+        float* __restrict s1 = s1_.data();
+        float* __restrict s2 = s2_.data();
+        const float* __restrict c = coeff_.data();
+        for (std::size_t i = 0; i < frames; ++i) {
+            const float xi = x[i];
+            for (std::size_t k = 0; k < n_; ++k) {
+                const float s0 = xi + c[k] * s1[k] - s2[k];
+                s2[k] = s1[k];
+                s1[k] = s0;
+            }
+        }
+    }
+
+    void restart_window() noexcept
+    {
+        std::fill(s1_.begin(), s1_.end(), 0.0f);
+        std::fill(s2_.begin(), s2_.end(), 0.0f);
+        filled_ = 0;
+    }
+
+    void finish_window() noexcept
+    {
+        ++windows_;
+        const double a = 1.0 / static_cast<double>(std::min<std::uint64_t>(windows_, cfg_.averages));
+        const double n = static_cast<double>(cfg_.window);
+        auto& out = results_.back();
+        for (std::size_t k = 0; k < n_; ++k) {
+            const double w = omega_[k];
+            // X = sum x[m] e^{-iwm} = e^{-iw(N-1)} (s1 - e^{-iw} s2), then
+            // rotate by the window start to reference the stimulus clock.
+            const std::complex<double> y = std::complex<double>(s1_[k]) - std::polar(1.0, -w) * static_cast<double>(s2_[k]);
+            const std::complex<double> x = y * std::polar(2.0 / n, -two_pi * clock_cycles(k));
+
+            const std::complex<double> d = x - mean_[k];
+            mean_[k] += a * d;
+            var_[k] = (1.0 - a) * (var_[k] + a * std::norm(d));
+
+            // Scatter of single windows -> standard error of the average.
+            const double eff = std::min<double>(static_cast<double>(windows_), (2.0 - a) / a);
+            const double noise = std::sqrt(var_[k] / std::max(eff, 1.0));
+            const double amp = std::abs(mean_[k]);
+            DetectorReading& r = out[k];
+            r.frequency = cfg_.frequencies[k];
+            r.amplitude = static_cast<float>(amp);
+            r.phase = static_cast<float>(std::arg(mean_[k]));
+            r.noise = static_cast<float>(noise);
+            r.snr_db = noise > 0.0 ? static_cast<float>(20.0 * std::log10(amp / noise)) : 0.0f;
+            r.windows = windows_;
+        }
+        results_.publish();
+        restart_window();
+    }
+
+    // Fractional cycles of bin k elapsed at the last sample of the window.
+    // Evaluated in extended precision: the stimulus clock runs for days, and
+    // w * t in double would lose milliradians by then.
+    double clock_cycles(std::size_t k) const noexcept
+    {
+        const long double t = static_cast<long double>(window_start_ + cfg_.window - 1);
+        const long double c = static_cast<long double>(cfg_.frequencies[k]) / static_cast<long double>(cfg_.sample_rate) * t;
+        return static_cast<double>(c - std::floor(c));
+    }
+
+    static constexpr double two_pi = 6.28318530717958647692;
+
+    Config cfg_;
+    std::size_t n_;
+    std::vector<double> omega_;
+    AlignedBuffer<float> coeff_, s1_, s2_;
+    std::vector<std::complex<double>> mean_;
+    std::vector<double> var_;
+    TripleBuffer<std::vector<DetectorReading>> results_;
+    std::uint64_t window_start_ = 0;
+    std::size_t filled_ = 0;
+    std::uint64_t windows_ = 0;
+};
+
+} // namespace asg
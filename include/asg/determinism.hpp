@@ -0,0 +1,370 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+#include <asg/batch_renderer.hpp>
+#include <asg/block_adapter.hpp>
+#include <asg/correlated_noise.hpp>
+#include <asg/fp_contract.hpp>
+#include <asg/gap_noise.hpp>
+#include <asg/lossless_codec.hpp>
+#include <asg/moving_ripple.hpp>
+#include <asg/procedural.hpp>
+#include <asg/spectral_synth.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace asg {
+
+/// Instruction set the translation unit was compiled for, recorded with
+/// golden data. Built with -ffp-contract=off (fp_contract.hpp), every
+/// ISA level on x86 from SSE2 to -march=native reproduces golden data
+/// bit for bit; a case's max_ulp only has to absorb a different libm,
+/// i.e. golden data from another platform.
+inline const char* build_isa() noexcept
+{
+#if defined(__AVX512F__)
+    return "x86-avx512";
+#elif defined(__AVX2__)
+    return "x86-avx2";
+#elif defined(__SSE2__) || defined(_M_X64)
+    return "x86-sse2";
+#elif defined(__ARM_NEON)
+    return "arm-neon";
+#else
+    return "generic";
+#endif
+}
+
+/// Distance in units in the last place between two floats; 0 for equal
+/// bit patterns and for +0/-0. NaNs are infinitely far from everything.
+inline std::uint64_t ulp_distance(float a, float b) noexcept
+{
+    if (a != a || b != b)
+        return UINT64_MAX;
+    auto key = [](float f) {
+        const auto u = std::bit_cast<std::uint32_t>(f);
+        // Map to a monotonic signed integer line.
+        return (u & 0x80000000u) ? -static_cast<std::int64_t>(u & 0x7FFFFFFFu) : static_cast<std::int64_t>(u);
+    };
+    const std::int64_t d = key(a) - key(b);
+    return static_cast<std::uint64_t>(d < 0 ? -d : d);
+}
+
+/// FNV-1a over sample bit patterns.
+inline std::uint64_t hash_samples(std::span<const float> x) noexcept
+{
+    std::uint64_t h = 0xCBF29CE484222325ull;
+    for (float f : x) {
+        std::uint32_t u = std::bit_cast<std::uint32_t>(f);
+        for (int b = 0; b < 4; ++b, u >>= 8)
+            h = (h ^ (u & 0xFF)) * 0x100000001B3ull;
+    }
+    return h;
+}
+
+/// How a case is rendered. The reference variant is {1, 0}: one thread,
+/// the case's natural block size.
+struct RenderVariant {
+    std::size_t threads = 1;
+    std::size_t block_size = 0; ///< 0 = whole buffer in one call
+};
+
+/// One reference stimulus. `render` must fill `out` (frames samples) for
+/// the given variant. `max_ulp` is the tolerance against golden data
+/// recorded on another ISA; it must be a measured bound, not a guess.
+/// Variants on the same build must always match the reference variant
+/// bit for bit.
+struct DeterminismCase {
+    std::string name;
+    std::size_t frames = 0;
+    std::uint32_t max_ulp = 0;
+    std::function<void(const RenderVariant&, std::span<float>)> render;
+};
+
+struct DeterminismResult {
+    std::string case_name;
+    std::string check; ///< "variant threads=T block=B" or "golden"
+    bool passed = false;
+    std::uint64_t max_ulp = 0;
+    std::size_t first_mismatch = 0;
+};
+
+/// Call render(ptr, n) over `out` in blocks of `block` samples (0 = one call).
+template <typename RenderFn>
+void render_in_blocks(std::span<float> out, std::size_t block, RenderFn&& render)
+{
+    if (block == 0)
+        block = out.size();
+    for (std::size_t i = 0; i < out.size(); i += block)
+        render(out.data() + i, std::min(block, out.size() - i));
+}
+
+/// Renders a reference set under several thread counts and block sizes,
+/// requires all variants to be bit-identical, and checks the reference
+/// render against golden data.
+///
+/// Golden data stores, per case, the hash of the reference render and the
+/// samples themselves (lossless_codec). A matching hash passes outright;
+/// otherwise the samples are compared and the case passes only if every
+/// sample is within the case's max_ulp and the golden file was recorded on
+/// a different ISA. On the same ISA any difference is a failure.
+class DeterminismHarness {
+public:
+    struct Golden {
+        std::string isa;
+        std::uint64_t hash = 0;
+        std::vector<std::uint8_t> samples;
+    };
+
+    void add(DeterminismCase c) { cases_.push_back(std::move(c)); }
+    const std::vector<DeterminismCase>& cases() const noexcept { return cases_; }
+
+    std::vector<DeterminismResult> run(const std::vector<RenderVariant>& variants) const
+    {
+        std::vector<DeterminismResult> results;
+        for (const auto& c : cases_) {
+            AlignedBuffer<float> ref(c.frames);
+            c.render(RenderVariant{}, ref.span());
+
+            AlignedBuffer<float> out(c.frames);
+            for (const auto& v : variants) {
+                std::fill(out.begin(), out.end(), 0.0f);
+                c.render(v, out.span());
+                DeterminismResult r = compare(c.name, ref.span(), out.span());
+                r.check = "variant threads=" + std::to_string(v.threads) + " block=" + std::to_string(v.block_size);
+                r.passed = r.max_ulp == 0;
+                results.push_back(std::move(r));
+            }
+
+            const auto g = golden_.find(c.name);
+            if (g == golden_.end())
+                continue;
+            DeterminismResult r;
+            r.case_name = c.name;
+            r.check = "golden";
+            if (g->second.hash == hash_samples(ref.span())) {
+                r.passed = true;
+            } else {
+                AlignedBuffer<float> gold(lossless_codec::decoded_size(g->second.samples));
+                lossless_codec::decode(g->second.samples, gold.span());
+                if (gold.size() != ref.size()) {
+                    r.max_ulp = UINT64_MAX;
+                } else {
+                    r = compare(c.name, gold.span(), ref.span());
+                    r.check = "golden";
+                }
+                r.passed = g->second.isa != build_isa() && r.max_ulp <= c.max_ulp;
+            }
+            results.push_back(std::move(r));
+        }
+        return results;
+    }
+
+    /// Render the reference variant of every case and record it as golden.
+    void record_golden()
+    {
+        golden_.clear();
+        for (const auto& c : cases_) {
+            AlignedBuffer<float> ref(c.frames);
+            c.render(RenderVariant{}, ref.span());
+            golden_[c.name] = Golden{build_isa(), hash_samples(ref.span()), lossless_codec::encode(ref.span())};
+        }
+    }
+
+    void save_golden(const std::string& path) const
+    {
+        std::ofstream f(path, std::ios::binary | std::ios::trunc);
+        if (!f)
+            throw std::runtime_error("DeterminismHarness: cannot write " + path);
+        write_u64(f, golden_magic);
+        write_u64(f, golden_.size());
+        for (const auto& [name, g] : golden_) {
+            write_str(f, name);
+            write_str(f, g.isa);
+            write_u64(f, g.hash);
+            write_u64(f, g.samples.size());
+            f.write(reinterpret_cast<const char*>(g.samples.data()), static_cast<std::streamsize>(g.samples.size()));
+        }
+        if (!f)
+            throw std::runtime_error("DeterminismHarness: write failed: " + path);
+    }
+
+    void load_golden(const std::string& path)
+    {
+        std::ifstream f(path, std::ios::binary);
+        if (!f)
+            throw std::runtime_error("DeterminismHarness: cannot read " + path);
+        if (read_u64(f) != golden_magic)
+            throw std::runtime_error("DeterminismHarness: not a golden file: " + path);
+        golden_.clear();
+        const std::uint64_t n = read_u64(f);
+        for (std::uint64_t i = 0; i < n; ++i) {
+            const std::string name = read_str(f);
+            Golden g;
+            g.isa = read_str(f);
+            g.hash = read_u64(f);
+            g.samples.resize(read_u64(f));
+            f.read(reinterpret_cast<char*>(g.samples.data()), static_cast<std::streamsize>(g.samples.size()));
+            if (!f)
+                throw std::runtime_error("DeterminismHarness: truncated golden file: " + path);
+            golden_[name] = std::move(g);
+        }
+    }
+
+    const std::map<std::string, Golden>& golden() const noexcept { return golden_; }
+
+private:
+    static constexpr std::uint64_t golden_magic = 0x31444C4F47475341ull; // "ASGGOLD1"
+
+    static DeterminismResult compare(const std::string& name, std::span<const float> ref, std::span<const float> out)
+    {
+        DeterminismResult r;
+        r.case_name = name;
+        bool first = true;
+        for (std::size_t i = 0; i < ref.size(); ++i) {
+            const std::uint64_t d = ulp_distance(ref[i], out[i]);
+            if (d && first) {
+                r.first_mismatch = i;
+                first = false;
+            }
+            r.max_ulp = std::max(r.max_ulp, d);
+        }
+        return r;
+    }
+
+    static void write_u64(std::ostream& f, std::uint64_t v) { f.write(reinterpret_cast<const char*>(&v), sizeof v); }
+    static std::uint64_t read_u64(std::istream& f)
+    {
+        std::uint64_t v = 0;
+        f.read(reinterpret_cast<char*>(&v), sizeof v);
+        return v;
+    }
+    static void write_str(std::ostream& f, const std::string& s)
+    {
+        write_u64(f, s.size());
+        f.write(s.data(), static_cast<std::streamsize>(s.size()));
+    }
+    static std::string read_str(std::istream& f)
+    {
+        const std::uint64_t n = read_u64(f);
+        if (n > 4096)
+            throw std::runtime_error("DeterminismHarness: corrupt golden file");
+        std::string s(n, '\0');
+        f.read(s.data(), static_cast<std::streamsize>(n));
+        return s;
+    }
+
+    std::vector<DeterminismCase> cases_;
+    std::map<std::string, Golden> golden_;
+};
+
+/// Reference set covering the library's streaming generators, `seconds`
+/// long each. Batch cases split the stimulus into jobs rendered on
+/// `threads` workers; streaming cases are rendered in `block_size` pieces.
+/// Tolerances are 0: SSE2, AVX2+FMA and -march=native builds match
+/// exactly, and golden data from a platform with another libm should be
+/// re-recorded rather than loosened.
+inline void add_reference_set(DeterminismHarness& h, double sample_rate = 48000.0, double seconds = 1.0)
+{
+    const auto frames = static_cast<std::size_t>(sample_rate * seconds);
+
+    h.add({"correlated_noise", frames, 0, [](const RenderVariant& v, std::span<float> out) {
+               CorrelatedNoise n({.channels = 2, .rms = 0.1f, .seed = 42});
+               n.set_pair_correlation(0, 1, 0.5f);
+               std::vector<float> other(out.size());
+               render_in_blocks(out, v.block_size, [&](float* p, std::size_t k) {
+                   float* ch[2] = {p, other.data() + (p - out.data())};
+                   n.render(ch, k);
+               });
+           }});
+
+    h.add({"moving_ripple", frames, 0, [sample_rate](const RenderVariant& v, std::span<float> out) {
+               MovingRipple m({.sample_rate = sample_rate, .carriers = 64, .seed = 7});
+               render_in_blocks(out, v.block_size, [&](float* p, std::size_t k) { m.render(p, k); });
+           }});
+
+    h.add({"spectral_synth", frames, 0, [](const RenderVariant& v, std::span<float> out) {
+               SpectralSynth s({.fft_size = 1024, .hop = 256});
+               auto spectrum = [](std::uint64_t frame, std::span<cfloat> bins) {
+                   for (std::size_t k = 8; k < bins.size(); k += 16)
+                       bins[k] = std::polar(64.0f, 0.1f * static_cast<float>(frame * k));
+               };
+               render_in_blocks(out, v.block_size, [&](float* p, std::size_t k) { s.render(p, k, spectrum); });
+           }});
+
+    h.add({"block_adapter", frames, 0, [](const RenderVariant& v, std::span<float> out) {
+               CorrelatedNoise n({.channels = 2, .seed = 11});
+               n.set_correlation(0, 0.3f);
+               BlockAdapter<CorrelatedNoise> a(n, 64, 2);
+               // The second channel is deliberately misaligned so whole
+               // sub-blocks take both the direct and the internal path.
+               AlignedBuffer<float> other(out.size() + 1);
+               render_in_blocks(out, v.block_size, [&](float* p, std::size_t k) {
+                   float* ch[2] = {p, other.data() + 1 + (p - out.data())};
+                   a.render(ch, k);
+               });
+           }});
+
+    // Gap detection and TMTF: gaps with fresh noise after each, and
+    // sinusoidal AM, at positions that scale with the case length.
+    h.add({"gap_noise", frames, 0, [sample_rate](const RenderVariant& v, std::span<float> out) {
+               const std::uint64_t q = out.size() / 8;
+               GapNoise g({.sample_rate = sample_rate, .independent = true, .seed = 17},
+                          {{.start = q, .length = 240},
+                           {.start = 2 * q, .length = 2 * q, .kind = GapKind::modulation, .rate = 8.0, .depth = 0.9f},
+                           {.start = 5 * q, .length = 48},
+                           {.start = 6 * q, .length = q, .kind = GapKind::modulation, .rate = 64.0, .depth = 0.5f}});
+               render_in_blocks(out, v.block_size, [&](float* p, std::size_t k) { g.render(p, k); });
+           }});
+
+    // Procedural tokens back to back, each rendered from whatever offset
+    // the block size lands on: a generator is a pure function of the
+    // sample index.
+    h.add({"procedural", frames, 0, [sample_rate](const RenderVariant& v, std::span<float> out) {
+               const ProceduralRegistry reg(sample_rate);
+               const std::uint64_t len = out.size() / 4;
+               const std::array<ProceduralToken, 4> tokens{{
+                   {.generator = procedural_tone, .ramp = 240, .seed = 0, .length = len, .params = {1000.0f, 0.5f, 0.3f}},
+                   {.generator = procedural_harmonic, .ramp = 240, .seed = 5, .length = len, .params = {220.0f, 0.05f, 1.0f, 40.0f}},
+                   {.generator = procedural_sam_noise, .ramp = 240, .seed = 9, .length = len, .params = {0.2f, 40.0f, 0.8f}},
+                   {.generator = procedural_noise, .ramp = 0, .seed = 13, .length = out.size() - 3 * len, .params = {0.1f}},
+               }};
+               render_in_blocks(out, v.block_size, [&](float* p, std::size_t k) {
+                   for (std::size_t done = 0; done < k;) {
+                       const auto t = static_cast<std::uint64_t>(p - out.data()) + done;
+                       const std::size_t i = static_cast<std::size_t>(std::min<std::uint64_t>(t / len, 3));
+                       const std::uint64_t first = t - i * len;
+                       const auto n = static_cast<std::size_t>(std::min<std::uint64_t>(k - done, tokens[i].length - first));
+                       reg.render(tokens[i], first, p + done, n);
+                       done += n;
+                   }
+               });
+           }});
+
+    // Noise rendered as independent jobs: any thread count must give the
+    // same result because every job is a pure function of its index.
+    h.add({"batch_noise", frames, 0, [](const RenderVariant& v, std::span<float> out) {
+               const std::size_t job = 4096;
+               std::vector<std::size_t> sizes;
+               for (std::size_t i = 0; i < out.size(); i += job)
+                   sizes.push_back(std::min(job, out.size() - i));
+               BatchRenderer br({.huge_pages = HugePages::none, .numa = false, .threads = std::max<std::size_t>(1, v.threads)});
+               const CounterRng rng(3);
+               auto res = br.render(sizes, [&](std::size_t j, std::span<float> o) { rng.fill_normal(o.data(), o.size(), j * job); });
+               for (std::size_t j = 0; j < res.jobs(); ++j)
+                   std::copy(res.job(j).begin(), res.job(j).end(), out.begin() + static_cast<std::ptrdiff_t>(j * job));
+           }});
+}
+
+} // namespace asg
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+#include <asg/fft.hpp>
+#include <asg/rng.hpp>
+#include <asg/spsc_queue.hpp>
+#include <asg/wav.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace asg {
+
+/// A block of captured input handed from the audio callback to analysis.
+/// Data is planar: channel c starts at data + c * capacity.
+struct CaptureBlock {
+    std::uint64_t sample = 0; ///< stimulus-clock position of frame 0, latency compensated
+    std::size_t frames = 0;
+    std::size_t channels = 0;
+    std::size_t capacity = 0;
+    float* data = nullptr;
+
+    const float* channel(std::size_t c) const noexcept { return data + c * capacity; }
+};
+
+/// Synchronous play-and-record engine.
+///
+/// process() is called from the device's duplex callback: it renders the
+/// output block and captures the simultaneous input block, so both share
+/// one sample clock. Captured input is packed into fixed-size blocks from
+/// a preallocated pool and passed to analysis threads through an SPSC
+/// queue; analysis returns blocks with release(). Nothing on the callback
+/// path blocks or allocates.
+///
+/// Every captured block is stamped with the stimulus-clock position of its
+/// first frame minus the round-trip latency, so an input sample stamped s
+/// is the acoustic response to output sample s. Measure the latency with
+/// LatencyCalibrator and apply it with set_latency().
+class DuplexEngine {
+public:
+    struct Config {
+        std::size_t input_channels = 1;
+        std::size_t output_channels = 1;
+        std::size_t capture_frames = 256; ///< frames per handed-off block
+        std::size_t capture_blocks = 64;  ///< pool size
+        std::int64_t latency = 0;         ///< round-trip latency in samples
+    };
+
+    explicit DuplexEngine(const Config& cfg)
+        : cfg_(cfg),
+          storage_(cfg.capture_frames * cfg.input_channels * cfg.capture_blocks),
+          blocks_(cfg.capture_blocks),
+          free_(cfg.capture_blocks),
+          full_(cfg.capture_blocks),
+          latency_(cfg.latency)
+    {
+        if (cfg.capture_frames == 0 || cfg.capture_blocks == 0 || cfg.input_channels == 0)
+            throw std::invalid_argument("DuplexEngine: bad capture configuration");
+        for (std::size_t b = 0; b < cfg.capture_blocks; ++b) {
+            CaptureBlock& blk = blocks_[b];
+            blk.channels = cfg.input_channels;
+            blk.capacity = cfg.capture_frames;
+            blk.data = storage_.data() + b * cfg.capture_frames * cfg.input_channels;
+            free_.try_push(&blk);
+        }
+    }
+
+    std::size_t input_channels() const noexcept { return cfg_.input_channels; }
+    std::size_t output_channels() const noexcept { return cfg_.output_channels; }
+
+    /// Stimulus clock at the start of the next callback.
+    std::uint64_t position() const noexcept { return pos_; }
+
+    std::int64_t latency() const noexcept { return latency_.load(std::memory_order_relaxed); }
+
+    /// Takes effect from the next captured block.
+    void set_latency(std::int64_t samples) noexcept { latency_.store(samples, std::memory_order_relaxed); }
+
+    /// Input frames lost because analysis did not return blocks in time.
+    std::uint64_t dropped_frames() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+    /// Duplex callback body. render(out, frames, position) must fill
+    /// output_channels() planar buffers.
+    template <typename RenderFn>
+    void process(const float* const* in, float* const* out, std::size_t frames, RenderFn&& render) noexcept
+    {
+        render(out, frames, pos_);
+        capture(in, frames);
+        pos_ += frames;
+    }
+
+    /// Analysis side: next filled block, or nullptr.
+    CaptureBlock* acquire() noexcept
+    {
+        CaptureBlock** b = full_.front();
+        if (!b)
+            return nullptr;
+        CaptureBlock* blk = *b;
+        full_.pop();
+        return blk;
+    }
+
+    /// Analysis side: return a block obtained from acquire().
+    void release(CaptureBlock* blk) noexcept { free_.try_push(blk); }
+
+private:
+    void capture(const float* const* in, std::size_t frames) noexcept
+    {
+        std::size_t done = 0;
+        while (done < frames) {
+            if (!current_) {
+                CaptureBlock** b = free_.front();
+                if (!b) {
+                    dropped_.fetch_add(frames - done, std::memory_order_relaxed);
+                    return;
+                }
+                current_ = *b;
+                free_.pop();
+                current_->frames = 0;
+                current_->sample = static_cast<std::uint64_t>(static_cast<std::int64_t>(pos_ + done) - latency());
+            }
+            const std::size_t n = std::min(frames - done, current_->capacity - current_->frames);
+            for (std::size_t c = 0; c < cfg_.input_channels; ++c)
+                std::memcpy(current_->data + c * current_->capacity + current_->frames, in[c] + done, n * sizeof(float));
+            current_->frames += n;
+            done += n;
+            if (current_->frames == current_->capacity) {
+                full_.try_push(current_);
+                current_ = nullptr;
+            }
+        }
+    }
+
+    Config cfg_;
+    AlignedBuffer<float> storage_;
+    std::vector<CaptureBlock> blocks_;
+    SpscQueue<CaptureBlock*> free_;
+    SpscQueue<CaptureBlock*> full_;
+    CaptureBlock* current_ = nullptr;
+    std::uint64_t pos_ = 0;
+    std::atomic<std::int64_t> latency_;
+    std::atomic<std::uint64_t> dropped_{0};
+};
+
+/// Lag (in samples, 0..max_lag) at which `recorded` best matches `probe`,
+/// found by FFT cross-correlation.
+inline std::size_t estimate_lag(std::span<const float> probe, std::span<const float> recorded, std::size_t max_lag)
+{
+    std::size_t n = 4;
+    while (n < probe.size() + recorded.size())
+        n <<= 1;
+    FftPlan plan(n);
+    AlignedBuffer<float> a(n), b(n);
+    AlignedBuffer<cfloat> fa(plan.bins()), fb(plan.bins());
+    std::copy(recorded.begin(), recorded.end(), a.begin());
+    std::copy(probe.begin(), probe.end(), b.begin());
+    plan.forward(a.data(), fa.data());
+    plan.forward(b.data(), fb.data());
+    for (std::size_t k = 0; k < plan.bins(); ++k)
+        fa[k] *= std::conj(fb[k]);
+    plan.inverse(fa.data(), a.data());
+    std::size_t best = 0;
+    for (std::size_t lag = 1; lag <= std::min(max_lag, n - 1); ++lag)
+        if (std::fabs(a[lag]) > std::fabs(a[best]))
+            best = lag;
+    return best;
+}
+
+/// Measures round-trip latency through a DuplexEngine.
+///
+/// Use render() as (or inside) the engine's render function and feed()
+/// every captured block; the engine's latency must be 0 meanwhile. The
+/// probe is a Hann-windowed white-noise burst, whose autocorrelation is a
+/// single sharp peak.
+class LatencyCalibrator {
+public:
+    LatencyCalibrator(std::size_t probe_frames, std::size_t max_latency, float level = 0.25f, std::uint64_t seed = 1)
+        : probe_(probe_frames), recorded_(probe_frames + max_latency), max_latency_(max_latency)
+    {
+        const CounterRng rng(seed);
+        const double pi = 3.14159265358979323846;
+        for (std::size_t i = 0; i < probe_frames; ++i) {
+            const double w = 0.5 - 0.5 * std::cos(2.0 * pi * double(i) / double(probe_frames));
+            probe_[i] = level * static_cast<float>(w) * rng.uniform_pm(i);
+        }
+    }
+
+    /// Start the probe at stimulus position `start`.
+    void begin(std::uint64_t start) noexcept
+    {
+        start_ = start;
+        received_ = 0;
+    }
+
+    /// Writes the probe to channel 0 and silence elsewhere.
+    void render(float* const* out, std::size_t frames, std::uint64_t position, std::size_t channels) const noexcept
+    {
+        for (std::size_t c = 0; c < channels; ++c)
+            std::fill(out[c], out[c] + frames, 0.0f);
+        for (std::size_t i = 0; i < frames; ++i) {
+            const std::uint64_t t = position + i;
+            if (t >= start_ && t - start_ < probe_.size())
+                out[0][i] = probe_[t - start_];
+        }
+    }
+
+    void feed(const CaptureBlock& blk) noexcept
+    {
+        for (std::size_t i = 0; i < blk.frames; ++i) {
+            const std::uint64_t t = blk.sample + i;
+            if (t >= start_ && t - start_ < recorded_.size()) {
+                recorded_[t - start_] = blk.channel(0)[i];
+                ++received_;
+            }
+        }
+    }
+
+    bool done() const noexcept { return received_ >= recorded_.size(); }
+
+    /// Measured latency, once done().
+    std::optional<std::int64_t> result() const
+    {
+        if (!done())
+            return std::nullopt;
+        return static_cast<std::int64_t>(estimate_lag(probe_.span(), recorded_.span(), max_latency_));
+    }
+
+private:
+    AlignedBuffer<float> probe_;
+    AlignedBuffer<float> recorded_;
+    std::size_t max_latency_;
+    std::uint64_t start_ = 0;
+    std::size_t received_ = 0;
+};
+
+/// Stand-in duplex device for headless runs.
+///
+/// Drives a callback with fixed-size blocks as a sound card would. Input
+/// comes from a WAV file, or, without one, from the device's own output
+/// fed back after `loopback_delay` samples (a simulated acoustic loop).
+/// The loop delay must be at least one block, as on real hardware: a
+/// block's input cannot contain output the callback has not produced yet.
+/// Output is kept in memory and optionally written to a WAV file.
+class FileDuplexDevice {
+public:
+    struct Config {
+        double sample_rate = 48000.0;
+        std::size_t input_channels = 1;
+        std::size_t output_channels = 1;
+        std::size_t block = 256;
+        std::string input_path;  ///< empty: simulated loopback
+        std::string output_path; ///< empty: keep output in memory only
+        std::size_t loopback_delay = 0; ///< samples, >= block; 0: one block
+        float loopback_gain = 1.0f;
+    };
+
+    explicit FileDuplexDevice(const Config& cfg) : cfg_(cfg)
+    {
+        if (cfg.block == 0 || cfg.input_channels == 0 || cfg.output_channels == 0)
+            throw std::invalid_argument("FileDuplexDevice: bad configuration");
+        if (!cfg.input_path.empty())
+            input_ = std::make_unique<MappedWav>(cfg.input_path);
+        else if (cfg_.loopback_delay == 0)
+            cfg_.loopback_delay = cfg.block;
+        else if (cfg_.loopback_delay < cfg.block)
+            throw std::invalid_argument("FileDuplexDevice: loopback delay shorter than a block");
+        output_.resize(cfg.output_channels);
+    }
+
+    /// Run for `frames` frames, calling cb(in, out, n) per block.
+    template <typename Callback>
+    void run(std::size_t frames, Callback&& cb)
+    {
+        const std::size_t block = cfg_.block;
+        std::vector<AlignedBuffer<float>> in(cfg_.input_channels), out(cfg_.output_channels);
+        std::vector<const float*> in_ptr(cfg_.input_channels);
+        std::vector<float*> out_ptr(cfg_.output_channels);
+        for (std::size_t c = 0; c < cfg_.input_channels; ++c)
+            in[c] = AlignedBuffer<float>(block), in_ptr[c] = in[c].data();
+        for (std::size_t c = 0; c < cfg_.output_channels; ++c)
+            out[c] = AlignedBuffer<float>(block), out_ptr[c] = out[c].data();
+
+        for (std::size_t done = 0; done < frames;) {
+            const std::size_t n = std::min(block, frames - done);
+            for (std::size_t c = 0; c < cfg_.input_channels; ++c) {
+                if (input_) {
+                    input_->read(std::min(c, input_->channels() - 1), pos_, in[c].data(), n);
+                } else {
+                    const auto& src = output_[c % cfg_.output_channels];
+                    for (std::size_t i = 0; i < n; ++i) {
+                        const std::size_t t = pos_ + i;
+                        in[c][i] = t >= cfg_.loopback_delay && t - cfg_.loopback_delay < src.size()
+                                       ? cfg_.loopback_gain * src[t - cfg_.loopback_delay]
+                                       : 0.0f;
+                    }
+                }
+            }
+            cb(in_ptr.data(), out_ptr.data(), n);
+            for (std::size_t c = 0; c < cfg_.output_channels; ++c)
+                output_[c].insert(output_[c].end(), out[c].data(), out[c].data() + n);
+            pos_ += n;
+            done += n;
+        }
+    }
+
+    const std::vector<float>& output(std::size_t channel) const noexcept { return output_[channel]; }
+
+    /// Write everything rendered so far to output_path (if set).
+    void flush() const
+    {
+        if (cfg_.output_path.empty())
+            return;
+        const std::size_t frames = output_[0].size();
+        std::vector<float> interleaved(frames * cfg_.output_channels);
+        for (std::size_t i = 0; i < frames; ++i)
+            for (std::size_t c = 0; c < cfg_.output_channels; ++c)
+                interleaved[i * cfg_.output_channels + c] = output_[c][i];
+        write_wav(cfg_.output_path, interleaved.data(), frames, cfg_.output_channels, cfg_.sample_rate);
+    }
+
+private:
+    Config cfg_;
+    std::unique_ptr<MappedWav> input_;
+    std::vector<std::vector<float>> output_;
+    std::size_t pos_ = 0;
+};
+
+} // namespace asg
@@ -0,0 +1,364 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+#include <asg/duplex.hpp>
+#include <asg/sequence.hpp>
+#include <asg/spsc_queue.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace asg {
+
+enum class EpochWeighting {
+    uniform,          ///< every accepted epoch counts equally
+    inverse_variance, ///< weight 1 / (epoch variance): noisy sweeps count less
+};
+
+/// Streaming stimulus-locked averager for ABR-style protocols.
+///
+/// Onsets come from the sequencer's cues: mark() is wait-free and is
+/// called on the audio thread with each Cue as render() emits it; a cue
+/// with negative gain is an inverted-polarity presentation. process() runs
+/// on the analysis thread with latency-compensated capture blocks, so a
+/// cue at sample s lines up with the captured response stamped s.
+///
+/// Epochs are cut from the stream into a fixed pool of buffers (a short
+/// history covers the pre-stimulus interval and late markers), checked
+/// against the artifact threshold, and folded into per-polarity running
+/// means with mean += (w / W) * (x - mean). Each accepted epoch therefore
+/// costs one vectorised pass over its samples, and the averages are
+/// always current; nothing is recomputed from stored sweeps.
+///
+/// Alternating-polarity averaging gives equal weight to the two polarity
+/// means, cancelling stimulus artifact and cochlear microphonic;
+/// difference() returns the polarity-dependent part instead. A ±average
+/// (alternate accepted epochs of each polarity sign-flipped) tracks the
+/// residual noise.
+///
+/// Everything except mark() belongs to the analysis thread.
+class EpochAverager {
+public:
+    struct Config {
+        std::size_t length = 480;       ///< epoch length in samples
+        std::size_t pre = 0;            ///< samples before onset included in the epoch
+        std::size_t channel = 0;        ///< capture channel analysed by process(CaptureBlock)
+        std::size_t max_pending = 32;   ///< epochs being collected at once
+        std::size_t marker_capacity = 1024;
+        float reject_threshold = 0.0f;  ///< peak |x| above which an epoch is rejected; 0 disables
+        EpochWeighting weighting = EpochWeighting::uniform;
+        std::optional<std::uint32_t> stimulus; ///< only average cues of this stimulus
+    };
+
+    explicit EpochAverager(const Config& cfg)
+        : cfg_(cfg),
+          markers_(cfg.marker_capacity),
+          storage_(cfg.length * cfg.max_pending),
+          slots_(cfg.max_pending),
+          history_(history_size(cfg.length + cfg.pre)),
+          mean_{AlignedBuffer<float>(cfg.length), AlignedBuffer<float>(cfg.length)},
+          plus_minus_(cfg.length)
+    {
+        if (cfg.length == 0 || cfg.max_pending == 0)
+            throw std::invalid_argument("EpochAverager: need a positive epoch length and pool");
+        for (std::size_t i = 0; i < slots_.size(); ++i)
+            slots_[i].data = storage_.data() + i * cfg.length;
+    }
+
+    std::size_t length() const noexcept { return cfg_.length; }
+
+    /// Audio thread: register a stimulus onset. Returns false if the marker
+    /// queue is full (the epoch is then lost and counted in missed()).
+    bool mark(const Cue& cue) noexcept
+    {
+        if (cfg_.stimulus && cue.stimulus != *cfg_.stimulus)
+            return true;
+        return mark(cue.sample, cue.gain < 0.0f ? -1 : 1);
+    }
+
+    /// Audio thread: register an onset at stimulus-clock `sample` with the
+    /// given polarity (+1 or -1) and extra weight.
+    bool mark(std::uint64_t sample, int polarity, float weight = 1.0f) noexcept
+    {
+        if (markers_.try_push(Marker{sample, polarity < 0, weight}))
+            return true;
+        lost_markers_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void process(const CaptureBlock& blk) noexcept
+    {
+        if (cfg_.channel < blk.channels)
+            process(blk.channel(cfg_.channel), blk.frames, blk.sample);
+    }
+
+    /// Feed `frames` samples stamped from stimulus-clock `first_sample`.
+    /// A discontinuity in the stamps abandons the epochs it cuts through.
+    void process(const float* x, std::size_t frames, std::uint64_t first_sample) noexcept
+    {
+        if (first_sample != pos_ || !started_) {
+            for (Slot& s : slots_) {
+                if (s.active) {
+                    s.active = false;
+                    ++missed_;
+                }
+            }
+            pos_ = valid_from_ = first_sample;
+            started_ = true;
+        }
+
+        while (const Marker* m = markers_.front()) {
+            begin_epoch(*m);
+            markers_.pop();
+        }
+
+        for (Slot& s : slots_) {
+            if (!s.active)
+                continue;
+            const std::uint64_t end = s.start + cfg_.length;
+            if (end <= pos_ || s.start >= pos_ + frames)
+                continue;
+            const std::uint64_t from = std::max(s.start, pos_);
+            const std::uint64_t to = std::min(end, pos_ + frames);
+            std::copy(x + (from - pos_), x + (to - pos_), s.data + (from - s.start));
+            if (to == end)
+                finish_epoch(s);
+        }
+
+        append_history(x, frames);
+        pos_ += frames;
+    }
+
+    /// Alternating-polarity average: the two polarity means weighted
+    /// equally, or the one present if only one polarity has been seen.
+    void average(std::span<float> out) const noexcept
+    {
+        combine(out, 1.0f);
+    }
+
+    /// Half the difference of the polarity means (the polarity-following
+    /// part of the response: stimulus artifact, cochlear microphonic).
+    void difference(std::span<float> out) const noexcept
+    {
+        combine(out, -1.0f);
+    }
+
+    /// Mean of one polarity (0 = positive, 1 = inverted).
+    std::span<const float> polarity_mean(std::size_t p) const noexcept { return mean_[p & 1].span(); }
+
+    /// ±average: the response cancels, leaving an estimate of the residual
+    /// noise in average().
+    std::span<const float> plus_minus() const noexcept { return plus_minus_.span(); }
+
+    /// RMS of the ±average, i.e. the residual noise level of average().
+    float noise_rms() const noexcept
+    {
+        const float* __restrict p = plus_minus_.data();
+        float acc[lanes] = {};
+        const std::size_t n = cfg_.length;
+        std::size_t i = 0;
+        for (; i + lanes <= n; i += lanes)
+            for (std::size_t l = 0; l < lanes; ++l)
+                acc[l] += p[i + l] * p[i + l];
+        for (; i < n; ++i)
+            acc[0] += p[i] * p[i];
+        float sum = 0.0f;
+        for (float a : acc)
+            sum += a;
+        return std::sqrt(sum / static_cast<float>(n));
+    }
+
+    std::uint64_t accepted() const noexcept { return count_[0] + count_[1]; }
+    std::uint64_t accepted(std::size_t p) const noexcept { return count_[p & 1]; }
+    std::uint64_t rejected() const noexcept { return rejected_; }
+    /// Epochs lost to a full pool or marker queue, stream gaps, or markers
+    /// older than the history.
+    std::uint64_t missed() const noexcept { return missed_ + lost_markers_.load(std::memory_order_relaxed); }
+
+    /// Clear the averages and counters; epochs in flight are kept.
+    void reset() noexcept
+    {
+        for (auto& m : mean_)
+            std::fill(m.begin(), m.end(), 0.0f);
+        std::fill(plus_minus_.begin(), plus_minus_.end(), 0.0f);
+        weight_[0] = weight_[1] = weight_total_ = 0.0;
+        count_[0] = count_[1] = 0;
+        rejected_ = missed_ = 0;
+        lost_markers_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr std::size_t lanes = 16;
+
+    struct Marker {
+        std::uint64_t sample;
+        bool inverted;
+        float weight;
+    };
+
+    struct Slot {
+        float* data = nullptr;
+        std::uint64_t start = 0;
+        float weight = 1.0f;
+        bool inverted = false;
+        bool active = false;
+    };
+
+    static std::size_t history_size(std::size_t n) noexcept
+    {
+        std::size_t s = 64;
+        while (s < n)
+            s <<= 1;
+        return s;
+    }
+
+    void begin_epoch(const Marker& m) noexcept
+    {
+        if (m.sample < cfg_.pre) {
+            ++missed_;
+            return;
+        }
+        const std::uint64_t start = m.sample - cfg_.pre;
+        const std::uint64_t oldest = std::max<std::uint64_t>(valid_from_, pos_ > history_.size() ? pos_ - history_.size() : 0);
+        if (start < oldest) {
+            ++missed_;
+            return;
+        }
+        Slot* slot = nullptr;
+        for (Slot& s : slots_) {
+            if (!s.active) {
+                slot = &s;
+                break;
+            }
+        }
+        if (!slot) {
+            ++missed_;
+            return;
+        }
+        slot->start = start;
+        slot->weight = m.weight;
+        slot->inverted = m.inverted;
+        slot->active = true;
+
+        // Part of the epoch already streamed past: take it from history.
+        const std::uint64_t to = std::min<std::uint64_t>(pos_, start + cfg_.length);
+        const std::size_t mask = history_.size() - 1;
+        for (std::uint64_t t = start; t < to; ++t)
+            slot->data[t - start] = history_[t & mask];
+        if (to == start + cfg_.length)
+            finish_epoch(*slot);
+    }
+
+    void append_history(const float* x, std::size_t frames) noexcept
+    {
+        const std::size_t size = history_.size();
+        std::uint64_t at = pos_;
+        if (frames > size) {
+            x += frames - size;
+            at += frames - size;
+            frames = size;
+        }
+        const std::size_t off = at & (size - 1);
+        const std::size_t first = std::min(frames, size - off);
+        std::copy(x, x + first, history_.data() + off);
+        std::copy(x + first, x + frames, history_.data());
+    }
+
+    void finish_epoch(Slot& s) noexcept
+    {
+        s.active = false;
+        const float* __restrict x = s.data;
+        const std::size_t n = cfg_.length;
+
+        float peak[lanes] = {}, sum[lanes] = {}, sq[lanes] = {};
+        std::size_t i = 0;
+        for (; i + lanes <= n; i += lanes) {
+            for (std::size_t l = 0; l < lanes; ++l) {
+                const float v = x[i + l];
+                peak[l] = std::max(peak[l], std::fabs(v));
+                sum[l] += v;
+                sq[l] += v * v;
+            }
+        }
+        for (; i < n; ++i) {
+            peak[0] = std::max(peak[0], std::fabs(x[i]));
+            sum[0] += x[i];
+            sq[0] += x[i] * x[i];
+        }
+        float pk = 0.0f;
+        double s1 = 0.0, s2 = 0.0;
+        for (std::size_t l = 0; l < lanes; ++l) {
+            pk = std::max(pk, peak[l]);
+            s1 += sum[l];
+            s2 += sq[l];
+        }
+        if (cfg_.reject_threshold > 0.0f && pk > cfg_.reject_threshold) {
+            ++rejected_;
+            return;
+        }
+
+        double w = s.weight;
+        if (cfg_.weighting == EpochWeighting::inverse_variance) {
+            const double mean = s1 / static_cast<double>(n);
+            const double var = s2 / static_cast<double>(n) - mean * mean;
+            w /= std::max(var, 1e-20);
+        }
+        if (!(w > 0.0))
+            return;
+
+        const std::size_t p = s.inverted ? 1 : 0;
+        weight_[p] += w;
+        ++count_[p];
+        accumulate(mean_[p].data(), x, static_cast<float>(w / weight_[p]), 1.0f);
+
+        weight_total_ += w;
+        const float sign = count_[p] & 1 ? 1.0f : -1.0f; // per polarity, so CM cancels too
+        accumulate(plus_minus_.data(), x, static_cast<float>(w / weight_total_), sign);
+    }
+
+    void accumulate(float* __restrict mean, const float* __restrict x, float k, float sign) const noexcept
+    {
+        for (std::size_t i = 0; i < cfg_.length; ++i)
+            mean[i] += k * (sign * x[i] - mean[i]);
+    }
+
+    void combine(std::span<float> out, float sign) const noexcept
+    {
+        const std::size_t n = std::min(out.size(), cfg_.length);
+        const float* __restrict a = mean_[0].data();
+        const float* __restrict b = mean_[1].data();
+        float ka = 0.5f, kb = 0.5f * sign;
+        if (count_[1] == 0)
+            ka = sign > 0.0f ? 1.0f : 0.0f, kb = 0.0f;
+        else if (count_[0] == 0)
+            ka = 0.0f, kb = sign > 0.0f ? 1.0f : 0.0f;
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = ka * a[i] + kb * b[i];
+    }
+
+    Config cfg_;
+    SpscQueue<Marker> markers_;
+    AlignedBuffer<float> storage_;
+    std::vector<Slot> slots_;
+    AlignedBuffer<float> history_;
+    AlignedBuffer<float> mean_[2];
+    AlignedBuffer<float> plus_minus_;
+    double weight_[2] = {0.0, 0.0};
+    double weight_total_ = 0.0;
+    std::uint64_t count_[2] = {0, 0};
+    std::uint64_t rejected_ = 0;
+    std::uint64_t missed_ = 0;
+    std::atomic<std::uint64_t> lost_markers_{0};
+    std::uint64_t pos_ = 0;
+    std::uint64_t valid_from_ = 0;
+    bool started_ = false;
+};
+
+} // namespace asg
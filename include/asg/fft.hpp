@@ -0,0 +1,117 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace asg {
+
+using cfloat = std::complex<float>;
+
+/// Real-input FFT of a fixed power-of-two size.
+///
+/// A plan owns its twiddle tables and scratch, so transforms never
+/// allocate; one plan must not be used by two threads at once. The
+/// real transform is computed as a half-size complex FFT on the
+/// even/odd-interleaved input plus a split step.
+///
+/// forward() is unnormalised; inverse() scales by 1/N, so
+/// inverse(forward(x)) == x.
+class FftPlan {
+public:
+    explicit FftPlan(std::size_t n) : n_(n), h_(n / 2), scratch_(n / 2)
+    {
+        if (n < 4 || (n & (n - 1)) != 0)
+            throw std::invalid_argument("FftPlan: size must be a power of two >= 4");
+        const double pi = 3.14159265358979323846;
+        tw_.resize(h_ / 2);
+        for (std::size_t j = 0; j < h_ / 2; ++j)
+            tw_[j] = std::polar(1.0, -2.0 * pi * double(j) / double(h_));
+        split_.resize(h_ + 1);
+        for (std::size_t k = 0; k <= h_; ++k)
+            split_[k] = std::polar(1.0, -2.0 * pi * double(k) / double(n_));
+        bitrev_.resize(h_);
+        std::size_t bits = 0;
+        while ((std::size_t(1) << bits) < h_)
+            ++bits;
+        for (std::size_t i = 0; i < h_; ++i) {
+            std::size_t r = 0;
+            for (std::size_t b = 0; b < bits; ++b)
+                r |= ((i >> b) & 1u) << (bits - 1 - b);
+            bitrev_[i] = static_cast<std::uint32_t>(r);
+        }
+    }
+
+    std::size_t size() const noexcept { return n_; }
+    std::size_t bins() const noexcept { return h_ + 1; }
+
+    /// in: size() reals; out: bins() complex values.
+    void forward(const float* in, cfloat* out) noexcept
+    {
+        cfloat* z = scratch_.data();
+        for (std::size_t k = 0; k < h_; ++k)
+            z[bitrev_[k]] = cfloat(in[2 * k], in[2 * k + 1]);
+        transform(z, false);
+        for (std::size_t k = 0; k <= h_; ++k) {
+            const cfloat a = z[k == h_ ? 0 : k];
+            const cfloat b = std::conj(z[k == 0 ? 0 : h_ - k]);
+            const cfloat e = 0.5f * (a + b);
+            const cfloat o = cfloat(0.0f, -0.5f) * (a - b);
+            out[k] = e + split_[k] * o;
+        }
+    }
+
+    /// in: bins() complex values (imaginary parts of DC and Nyquist are
+    /// ignored); out: size() reals.
+    void inverse(const cfloat* in, float* out) noexcept
+    {
+        cfloat* z = scratch_.data();
+        const float scale = 1.0f / static_cast<float>(h_);
+        for (std::size_t k = 0; k < h_; ++k) {
+            const cfloat a = in[k];
+            const cfloat b = std::conj(in[h_ - k]);
+            const cfloat e = 0.5f * (a + b);
+            const cfloat o = 0.5f * (a - b) * std::conj(split_[k]);
+            z[bitrev_[k]] = (e + cfloat(0.0f, 1.0f) * o) * scale;
+        }
+        transform(z, true);
+        for (std::size_t k = 0; k < h_; ++k) {
+            out[2 * k] = z[k].real();
+            out[2 * k + 1] = z[k].imag();
+        }
+    }
+
+private:
+    /// In-place radix-2 DIT on bit-reversed input.
+    void transform(cfloat* a, bool inverse) const noexcept
+    {
+        for (std::size_t len = 2; len <= h_; len <<= 1) {
+            const std::size_t half = len / 2;
+            const std::size_t step = h_ / len;
+            for (std::size_t i = 0; i < h_; i += len) {
+                for (std::size_t j = 0; j < half; ++j) {
+                    const cfloat w = inverse ? std::conj(tw_[j * step]) : tw_[j * step];
+                    const cfloat u = a[i + j];
+                    const cfloat v = a[i + j + half] * w;
+                    a[i + j] = u + v;
+                    a[i + j + half] = u - v;
+                }
+            }
+        }
+    }
+
+    std::size_t n_;
+    std::size_t h_;
+    std::vector<cfloat> tw_;
+    std::vector<cfloat> split_;
+    std::vector<std::uint32_t> bitrev_;
+    AlignedBuffer<cfloat> scratch_;
+};
+
+} // namespace asg
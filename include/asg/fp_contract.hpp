@@ -0,0 +1,36 @@
+#pragma once
+
+namespace asg {
+
+/// Floating-point contraction (a * b + c fused into one FMA) and
+/// reproducible output.
+///
+/// GCC contracts by default (-ffp-contract=fast) whenever the target has
+/// FMA, so the same source rounds differently under -mfma, -mavx2 or
+/// -march=native than under plain SSE2, and a generator's samples depend
+/// on the machine the code was built for. Builds whose output must match
+/// golden data across machines (see determinism.hpp) therefore compile
+/// every translation unit with contraction off:
+///
+///     GCC, Clang   -ffp-contract=off
+///     MSVC         /fp:precise (contracts only with /fp:contract or /fp:fast)
+///
+/// This is a build setting rather than a per-header pragma: it covers
+/// every header, including ones added later, and GCC's
+/// `#pragma GCC optimize` would give each function in the region its own
+/// optimisation attributes, which stops it being inlined into callers
+/// outside the region (per-sample calls such as CounterRng::normal).
+///
+/// fp_contraction_off() reports whether the calling translation unit was
+/// built that way; it is conservative only where the target has no FMA,
+/// in which case nothing can be contracted anyway.
+inline bool fp_contraction_off() noexcept
+{
+    // a * a rounds to b exactly, so an unfused a * a - b is 0, while a
+    // fused multiply-subtract keeps the 2^-60 term.
+    volatile double va = 1.0 + 0x1p-30, vb = 1.0 + 0x1p-29;
+    const double a = va, b = vb;
+    return a * a - b == 0.0;
+}
+
+} // namespace asg
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+#include <asg/rng.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace asg {
+
+enum class GapKind { gap, modulation };
+
+/// One temporal event in the noise. A gap silences [start, start + length)
+/// with ramps of the configured length outside that interval, so `length`
+/// is the fully silent part. A modulation applies sinusoidal AM,
+/// 1 + depth * sin(2 pi rate t), over [start, start + length) with its
+/// depth ramped in and out.
+struct GapEvent {
+    std::uint64_t start = 0;
+    std::uint64_t length = 0;
+    GapKind kind = GapKind::gap;
+    double rate = 0.0;  ///< Hz, modulation only
+    float depth = 1.0f; ///< 0..1, modulation only
+};
+
+/// Streaming Gaussian noise with sample-accurate gaps and modulation, for
+/// gap-detection and TMTF tests.
+///
+/// Noise is counter-based on the absolute sample index, so it is the same
+/// however the stream is blocked. With `independent` set, each gap starts
+/// a new noise stream (the markers on either side of a gap are
+/// uncorrelated); otherwise the noise runs continuously underneath the
+/// gaps. The ramp is a raised-cosine table built once. render() keeps a
+/// cursor into the sorted events and touches only those overlapping the
+/// block, so its cost does not grow with the number of events.
+class GapNoise {
+public:
+    struct Config {
+        double sample_rate = 48000.0;
+        float level = 0.1f;       ///< RMS
+        std::size_t ramp = 24;    ///< samples per gap edge / depth ramp
+        bool independent = false; ///< fresh noise after each gap
+        std::uint64_t seed = 1;
+    };
+
+    explicit GapNoise(const Config& cfg, std::vector<GapEvent> events = {})
+        : cfg_(cfg), rng_(cfg.seed), ramp_(cfg.ramp)
+    {
+        if (!(cfg.sample_rate > 0.0))
+            throw std::invalid_argument("GapNoise: sample rate must be positive");
+        for (std::size_t i = 0; i < cfg.ramp; ++i) {
+            const double s = std::sin(1.57079632679489662 * (double(i) + 0.5) / double(cfg.ramp));
+            ramp_[i] = static_cast<float>(s * s);
+        }
+        set_events(std::move(events));
+    }
+
+    std::uint64_t position() const noexcept { return pos_; }
+    const std::vector<GapEvent>& events() const noexcept { return events_; }
+
+    /// Replace the event list (not real-time safe). Events must be sorted
+    /// and may not overlap, ramps included.
+    void set_events(std::vector<GapEvent> events)
+    {
+        std::vector<std::uint64_t> gaps(events.size() + 1, 0);
+        for (std::size_t i = 0; i < events.size(); ++i) {
+            const GapEvent& e = events[i];
+            if (e.kind == GapKind::modulation && (!(e.rate > 0.0) || e.depth < 0.0f || e.depth > 1.0f))
+                throw std::invalid_argument("GapNoise: modulation needs rate > 0 and depth in [0, 1]");
+            if (i > 0 && begin(e) < end(events[i - 1]))
+                throw std::invalid_argument("GapNoise: events overlap or are out of order");
+            gaps[i + 1] = gaps[i] + (e.kind == GapKind::gap);
+        }
+        events_ = std::move(events);
+        gaps_before_ = std::move(gaps);
+        seek(pos_);
+    }
+
+    /// Jump to an absolute sample.
+    void seek(std::uint64_t position) noexcept
+    {
+        pos_ = position;
+        const auto it = std::partition_point(events_.begin(), events_.end(),
+                                             [&](const GapEvent& e) { return end(e) <= static_cast<std::int64_t>(position); });
+        next_ = static_cast<std::size_t>(it - events_.begin());
+    }
+
+    /// Write the next `frames` samples.
+    void render(float* out, std::size_t frames) noexcept
+    {
+        const auto t0 = static_cast<std::int64_t>(pos_);
+        const auto t1 = t0 + static_cast<std::int64_t>(frames);
+        while (next_ < events_.size() && end(events_[next_]) <= t0)
+            ++next_;
+
+        // Noise, split where a gap starts a new stream.
+        std::size_t j = next_;
+        std::uint64_t segment = gaps_before_[j];
+        std::size_t done = 0;
+        while (done < frames) {
+            const std::uint64_t at = pos_ + done;
+            for (; j < events_.size() && events_[j].start <= at; ++j)
+                segment += events_[j].kind == GapKind::gap;
+            std::size_t n = frames - done;
+            if (cfg_.independent && j < events_.size() && events_[j].start < pos_ + frames)
+                n = static_cast<std::size_t>(events_[j].start - at);
+            (cfg_.independent ? rng_.stream(segment) : rng_).fill_normal(out + done, n, at);
+            done += n;
+        }
+        const float g = cfg_.level;
+        for (std::size_t i = 0; i < frames; ++i)
+            out[i] *= g;
+
+        for (std::size_t k = next_; k < events_.size() && begin(events_[k]) < t1; ++k) {
+            if (events_[k].kind == GapKind::gap)
+                apply_gap(events_[k], out, t0, t1);
+            else
+                apply_modulation(events_[k], out, t0, t1);
+        }
+        pos_ += frames;
+    }
+
+private:
+    std::int64_t begin(const GapEvent& e) const noexcept
+    {
+        const auto s = static_cast<std::int64_t>(e.start);
+        return e.kind == GapKind::gap ? s - static_cast<std::int64_t>(ramp_.size()) : s;
+    }
+
+    std::int64_t end(const GapEvent& e) const noexcept
+    {
+        const auto s = static_cast<std::int64_t>(e.start + e.length);
+        return e.kind == GapKind::gap ? s + static_cast<std::int64_t>(ramp_.size()) : s;
+    }
+
+    /// Down ramp, silence, up ramp, each clipped to the block [t0, t1).
+    void apply_gap(const GapEvent& e, float* out, std::int64_t t0, std::int64_t t1) const noexcept
+    {
+        const auto R = static_cast<std::int64_t>(ramp_.size());
+        const auto s = static_cast<std::int64_t>(e.start);
+        const auto f = s + static_cast<std::int64_t>(e.length);
+        const float* r = ramp_.data();
+        for (std::int64_t t = std::max(s - R, t0); t < std::min(s, t1); ++t)
+            out[t - t0] *= r[s - 1 - t];
+        for (std::int64_t t = std::max(s, t0); t < std::min(f, t1); ++t)
+            out[t - t0] = 0.0f;
+        for (std::int64_t t = std::max(f, t0); t < std::min(f + R, t1); ++t)
+            out[t - t0] *= r[t - f];
+    }
+
+    void apply_modulation(const GapEvent& e, float* out, std::int64_t t0, std::int64_t t1) const noexcept
+    {
+        const auto R = static_cast<std::int64_t>(ramp_.size());
+        const auto s = static_cast<std::int64_t>(e.start);
+        const auto L = static_cast<std::int64_t>(e.length);
+        const double w = 6.28318530717958647692 * e.rate / cfg_.sample_rate;
+        for (std::int64_t t = std::max(s, t0); t < std::min(s + L, t1); ++t) {
+            const std::int64_t u = t - s;
+            const std::int64_t edge = std::min(u, L - 1 - u);
+            const float depth = edge < R ? e.depth * ramp_[edge] : e.depth;
+            // Phase from the event-relative index, so it is exact at any offset.
+            const auto m = static_cast<float>(std::sin(w * static_cast<double>(u)));
+            out[t - t0] *= 1.0f + depth * m;
+        }
+    }
+
+    Config cfg_;
+    CounterRng rng_;
+    AlignedBuffer<float> ramp_; ///< raised-cosine rise, 0 -> 1
+    std::vector<GapEvent> events_;
+    std::vector<std::uint64_t> gaps_before_; ///< gaps among events_[0, i)
+    std::size_t next_ = 0;                   ///< first event not yet finished
+    std::uint64_t pos_ = 0;
+};
+
+} // namespace asg
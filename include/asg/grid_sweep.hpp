@@ -0,0 +1,206 @@
+#pragma once
+
+#include <asg/thread_pool.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace asg {
+
+/// One parameter of a factorial stimulus set.
+struct SweepAxis {
+    std::string name;
+    std::vector<double> values;
+};
+
+/// A point of the grid as seen by a stage: only the axes the stage
+/// declared are defined, and reading any other throws, so a stage cannot
+/// silently depend on a parameter its cached output is not keyed on.
+class SweepPoint {
+public:
+    SweepPoint(const std::vector<SweepAxis>& axes, std::vector<std::size_t> index, std::uint64_t used)
+        : axes_(&axes), index_(std::move(index)), used_(used)
+    {
+    }
+
+    double value(std::size_t axis) const { return axes_->at(axis).values[index(axis)]; }
+    double value(const std::string& name) const { return value(axis_of(name)); }
+
+    std::size_t index(std::size_t axis) const
+    {
+        if (axis >= index_.size() || !(used_ >> axis & 1))
+            throw std::logic_error("SweepPoint: stage did not declare axis " + std::to_string(axis));
+        return index_[axis];
+    }
+    std::size_t index(const std::string& name) const { return index(axis_of(name)); }
+
+private:
+    std::size_t axis_of(const std::string& name) const
+    {
+        for (std::size_t a = 0; a < axes_->size(); ++a)
+            if ((*axes_)[a].name == name)
+                return a;
+        throw std::invalid_argument("SweepPoint: no axis named " + name);
+    }
+
+    const std::vector<SweepAxis>* axes_;
+    std::vector<std::size_t> index_;
+    std::uint64_t used_;
+};
+
+/// Renders the Cartesian product of parameter axes through a chain of
+/// stages, each keyed on a subset of the axes.
+///
+/// A stage runs once per combination of its own axes, not once per grid
+/// point. For example, "frequency, duration" can synthesise the unscaled
+/// tone and "frequency, duration, level, ramp" can scale and gate it, so
+/// the tone is synthesised |frequency| x |duration| times however many
+/// levels and ramps are swept. Each stage's axes must include the previous
+/// stage's. A stage receives the previous stage's output for its
+/// projection and fills its own buffer. All combinations of a stage render
+/// in parallel on the pool; stages run in order, and a stage's buffers are
+/// released once the next stage has consumed them.
+///
+/// Grid points whose final-stage key coincides share one output buffer,
+/// so axes that the final stage ignores cost nothing.
+class GridSweep {
+public:
+    using StageFn = std::function<void(const SweepPoint&, std::span<const float> input, std::vector<float>& out)>;
+    using Buffer = std::shared_ptr<const std::vector<float>>;
+
+    struct Result {
+        std::vector<std::size_t> shape;
+        std::vector<Buffer> outputs;       ///< one per grid point, row-major (last axis fastest)
+        std::vector<std::size_t> renders;  ///< stage invocations, per stage
+
+        std::size_t size() const noexcept { return outputs.size(); }
+        const std::vector<float>& operator[](std::size_t flat) const noexcept { return *outputs[flat]; }
+    };
+
+    explicit GridSweep(std::vector<SweepAxis> axes) : axes_(std::move(axes))
+    {
+        if (axes_.empty() || axes_.size() > 64)
+            throw std::invalid_argument("GridSweep: need 1-64 axes");
+        for (const SweepAxis& a : axes_)
+            if (a.values.empty())
+                throw std::invalid_argument("GridSweep: axis " + a.name + " has no values");
+    }
+
+    const std::vector<SweepAxis>& axes() const noexcept { return axes_; }
+
+    std::size_t size() const noexcept
+    {
+        std::size_t n = 1;
+        for (const SweepAxis& a : axes_)
+            n *= a.values.size();
+        return n;
+    }
+
+    /// Append a stage keyed on the named axes.
+    GridSweep& stage(const std::vector<std::string>& axes, StageFn fn)
+    {
+        std::uint64_t mask = 0;
+        for (const std::string& name : axes) {
+            const auto it = std::find_if(axes_.begin(), axes_.end(), [&](const SweepAxis& a) { return a.name == name; });
+            if (it == axes_.end())
+                throw std::invalid_argument("GridSweep: no axis named " + name);
+            mask |= std::uint64_t(1) << (it - axes_.begin());
+        }
+        if (!stages_.empty() && (stages_.back().mask & ~mask))
+            throw std::invalid_argument("GridSweep: a stage must include the previous stage's axes");
+        stages_.push_back({mask, std::move(fn)});
+        return *this;
+    }
+
+    /// Render every stage over the grid.
+    Result render(ThreadPool& pool) const
+    {
+        if (stages_.empty())
+            throw std::logic_error("GridSweep: no stages");
+        Result r;
+        for (const SweepAxis& a : axes_)
+            r.shape.push_back(a.values.size());
+
+        std::vector<Buffer> prev;
+        std::uint64_t prev_mask = 0;
+        for (const Stage& st : stages_) {
+            const std::size_t keys = key_count(st.mask);
+            std::vector<Buffer> cur(keys);
+            pool.parallel_for(keys, [&](std::size_t k) {
+                std::vector<std::size_t> idx = unflatten(k, st.mask);
+                const std::span<const float> in = prev.empty() ? std::span<const float>{} : std::span<const float>(*prev[flatten(idx, prev_mask)]);
+                auto out = std::make_shared<std::vector<float>>();
+                st.fn(SweepPoint(axes_, std::move(idx), st.mask), in, *out);
+                cur[k] = std::move(out);
+            });
+            r.renders.push_back(keys);
+            prev = std::move(cur);
+            prev_mask = st.mask;
+        }
+
+        const std::size_t n = size();
+        r.outputs.resize(n);
+        for (std::size_t p = 0; p < n; ++p)
+            r.outputs[p] = prev[flatten(unflatten(p, all()), prev_mask)];
+        return r;
+    }
+
+    /// Grid coordinates of a row-major flat index.
+    std::vector<std::size_t> coordinates(std::size_t flat) const { return unflatten(flat, all()); }
+
+private:
+    struct Stage {
+        std::uint64_t mask;
+        StageFn fn;
+    };
+
+    std::uint64_t all() const noexcept
+    {
+        return axes_.size() == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << axes_.size()) - 1;
+    }
+
+    std::size_t key_count(std::uint64_t mask) const noexcept
+    {
+        std::size_t n = 1;
+        for (std::size_t a = 0; a < axes_.size(); ++a)
+            if (mask >> a & 1)
+                n *= axes_[a].values.size();
+        return n;
+    }
+
+    /// Row-major over the axes in `mask`; other coordinates are ignored.
+    std::size_t flatten(const std::vector<std::size_t>& idx, std::uint64_t mask) const noexcept
+    {
+        std::size_t k = 0;
+        for (std::size_t a = 0; a < axes_.size(); ++a)
+            if (mask >> a & 1)
+                k = k * axes_[a].values.size() + idx[a];
+        return k;
+    }
+
+    /// Inverse of flatten(); axes outside `mask` get index 0.
+    std::vector<std::size_t> unflatten(std::size_t k, std::uint64_t mask) const
+    {
+        std::vector<std::size_t> idx(axes_.size(), 0);
+        for (std::size_t a = axes_.size(); a-- > 0;) {
+            if (mask >> a & 1) {
+                idx[a] = k % axes_[a].values.size();
+                k /= axes_[a].values.size();
+            }
+        }
+        return idx;
+    }
+
+    std::vector<SweepAxis> axes_;
+    std::vector<Stage> stages_;
+};
+
+} // namespace asg
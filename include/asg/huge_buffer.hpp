@@ -0,0 +1,112 @@
+#pragma once
+
+#include <asg/mapped_file.hpp>
+
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include <sys/mman.h>
+
+namespace asg {
+
+enum class HugePages {
+    none,        ///< regular pages
+    transparent, ///< anonymous mapping advised with MADV_HUGEPAGE
+    explicit_,   ///< MAP_HUGETLB from the reserved pool; falls back to transparent
+};
+
+/// Large anonymous buffer for offline renders, optionally on huge pages.
+///
+/// Pages are not touched here: on Linux each page is placed on the NUMA
+/// node of the thread that first writes it, so callers control placement
+/// by which thread fills which range (see BatchRenderer). Sizes are
+/// rounded up to whole huge pages.
+template <typename T>
+class HugeBuffer {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+    static constexpr std::size_t huge_page = std::size_t(2) << 20;
+
+    HugeBuffer() noexcept = default;
+
+    HugeBuffer(std::size_t n, HugePages policy) : size_(n)
+    {
+        if (n == 0)
+            return;
+        bytes_ = (n * sizeof(T) + huge_page - 1) & ~(huge_page - 1);
+        void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        if (policy == HugePages::explicit_) {
+            p = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED)
+                policy_ = HugePages::explicit_;
+            else
+                policy = HugePages::transparent;
+        }
+#else
+        if (policy == HugePages::explicit_)
+            policy = HugePages::transparent;
+#endif
+        if (p == MAP_FAILED) {
+            p = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED)
+                throw sys_error("mmap");
+            policy_ = HugePages::none;
+#ifdef MADV_HUGEPAGE
+            if (policy == HugePages::transparent && ::madvise(p, bytes_, MADV_HUGEPAGE) == 0)
+                policy_ = HugePages::transparent;
+#endif
+        }
+        data_ = static_cast<T*>(p);
+    }
+
+    HugeBuffer(HugeBuffer&& o) noexcept
+        : data_(std::exchange(o.data_, nullptr)),
+          size_(std::exchange(o.size_, 0)),
+          bytes_(std::exchange(o.bytes_, 0)),
+          policy_(o.policy_)
+    {
+    }
+    HugeBuffer& operator=(HugeBuffer&& o) noexcept
+    {
+        if (this != &o) {
+            release();
+            data_ = std::exchange(o.data_, nullptr);
+            size_ = std::exchange(o.size_, 0);
+            bytes_ = std::exchange(o.bytes_, 0);
+            policy_ = o.policy_;
+        }
+        return *this;
+    }
+    HugeBuffer(const HugeBuffer&) = delete;
+    HugeBuffer& operator=(const HugeBuffer&) = delete;
+    ~HugeBuffer() { release(); }
+
+    T* data() noexcept { return data_; }
+    const T* data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+    std::span<T> span() noexcept { return {data_, size_}; }
+    std::span<const T> span() const noexcept { return {data_, size_}; }
+
+    /// The policy actually obtained, which may be weaker than requested.
+    HugePages policy() const noexcept { return policy_; }
+
+private:
+    void release() noexcept
+    {
+        if (data_)
+            ::munmap(data_, bytes_);
+        data_ = nullptr;
+        size_ = bytes_ = 0;
+    }
+
+    T* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t bytes_ = 0;
+    HugePages policy_ = HugePages::none;
+};
+
+} // namespace asg
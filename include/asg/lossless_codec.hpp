@@ -0,0 +1,432 @@
+#pragma once
+
+#include <asg/thread_pool.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace asg {
+
+/// Lightweight lossless codec for float sample buffers.
+///
+/// The stream is split into independently coded chunks so decoding runs
+/// in parallel. Each chunk picks the smallest of three modes:
+///
+///  - integer: every sample is k / 2^shift with |k| < 2^31 (true of
+///    anything quantised to 16/24-bit PCM). Samples are coded FLAC-style:
+///    fixed polynomial predictor of order 0-4 and Rice-coded residuals
+///    with one parameter per 512-sample partition.
+///  - float: the same fixed predictors evaluated on the float values;
+///    prediction and sample bit patterns are XORed and only the
+///    significant bits of the XOR are stored. Predictor coefficients are
+///    small integers, so every product is exact in double and the
+///    prediction is identical whether or not the compiler contracts to FMA.
+///  - verbatim: raw 32-bit samples, for incompressible data such as
+///    full-precision white noise.
+///
+/// Blob layout (little endian): u32 magic, u32 chunk_samples, u64 samples,
+/// u64 chunk_offsets[chunks + 1] relative to the blob, chunk data.
+namespace lossless_codec {
+
+inline constexpr std::uint32_t magic = 0x4C474153; // "SAGL"
+inline constexpr std::size_t chunk_samples = 4096;
+inline constexpr std::size_t partition = 512;
+inline constexpr unsigned max_order = 4;
+
+enum Mode : std::uint32_t { verbatim = 0, integer = 1, floating = 2 };
+
+namespace detail {
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<std::uint8_t>& out) : out_(out) {}
+
+    void put(std::uint64_t v, unsigned n)
+    {
+        // n <= 64; split so the accumulator never overflows.
+        if (n > 32) {
+            put(v >> 32, n - 32);
+            n = 32;
+            v &= 0xFFFFFFFFull;
+        }
+        acc_ = (acc_ << n) | (n == 64 ? v : v & ((std::uint64_t(1) << n) - 1));
+        bits_ += n;
+        while (bits_ >= 8) {
+            bits_ -= 8;
+            out_.push_back(static_cast<std::uint8_t>(acc_ >> bits_));
+        }
+    }
+
+    void flush()
+    {
+        if (bits_)
+            out_.push_back(static_cast<std::uint8_t>(acc_ << (8 - bits_)));
+        bits_ = 0;
+        acc_ = 0;
+    }
+
+private:
+    std::vector<std::uint8_t>& out_;
+    std::uint64_t acc_ = 0;
+    unsigned bits_ = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const std::uint8_t* p, const std::uint8_t* end) : p_(p), end_(end) {}
+
+    std::uint64_t get(unsigned n)
+    {
+        if (n > 32) {
+            const std::uint64_t hi = get(n - 32);
+            return (hi << 32) | get(32);
+        }
+        while (bits_ < n) {
+            if (p_ == end_)
+                throw std::runtime_error("lossless_codec: truncated chunk");
+            acc_ = (acc_ << 8) | *p_++;
+            bits_ += 8;
+        }
+        bits_ -= n;
+        return n == 0 ? 0 : (acc_ >> bits_) & ((std::uint64_t(1) << n) - 1);
+    }
+
+    unsigned unary(unsigned limit)
+    {
+        unsigned q = 0;
+        while (q < limit && get(1))
+            ++q;
+        return q;
+    }
+
+private:
+    const std::uint8_t* p_;
+    const std::uint8_t* end_;
+    std::uint64_t acc_ = 0;
+    unsigned bits_ = 0;
+};
+
+inline std::uint64_t zigzag(std::int64_t v) { return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63); }
+inline std::int64_t unzigzag(std::uint64_t u) { return static_cast<std::int64_t>(u >> 1) ^ -static_cast<std::int64_t>(u & 1); }
+
+/// FLAC fixed predictors; i < order uses the highest order available.
+template <typename T>
+inline T predict(const T* x, std::size_t i, unsigned order)
+{
+    switch (std::min<std::size_t>(order, i)) {
+    case 0: return T(0);
+    case 1: return x[i - 1];
+    case 2: return T(2) * x[i - 1] - x[i - 2];
+    case 3: return T(3) * x[i - 1] - T(3) * x[i - 2] + x[i - 3];
+    default: return T(4) * x[i - 1] - T(6) * x[i - 2] + T(4) * x[i - 3] - x[i - 4];
+    }
+}
+
+inline float predict_float(const float* x, std::size_t i, unsigned order)
+{
+    double d[max_order];
+    const std::size_t n = std::min<std::size_t>(order, i);
+    for (std::size_t k = 0; k < n; ++k)
+        d[k] = x[i - 1 - k];
+    double p = 0.0;
+    switch (n) {
+    case 0: break;
+    case 1: p = d[0]; break;
+    case 2: p = 2.0 * d[0] - d[1]; break;
+    case 3: p = 3.0 * d[0] - 3.0 * d[1] + d[2]; break;
+    default: p = 4.0 * d[0] - 6.0 * d[1] + 4.0 * d[2] - d[3]; break;
+    }
+    return static_cast<float>(p);
+}
+
+/// Rice escape: quotients >= escape are stored as escape ones + 64 raw bits.
+inline constexpr unsigned escape = 31;
+
+inline void rice_put(BitWriter& w, std::uint64_t u, unsigned k)
+{
+    const std::uint64_t q = u >> k;
+    if (q >= escape) {
+        w.put((std::uint64_t(1) << escape) - 1, escape);
+        w.put(u, 64);
+        return;
+    }
+    w.put(((std::uint64_t(1) << q) - 1) << 1, static_cast<unsigned>(q) + 1);
+    w.put(u, k);
+}
+
+inline std::uint64_t rice_get(BitReader& r, unsigned k)
+{
+    const unsigned q = r.unary(escape);
+    if (q == escape)
+        return r.get(64);
+    return (std::uint64_t(q) << k) | r.get(k);
+}
+
+inline std::size_t rice_bits(std::uint64_t u, unsigned k)
+{
+    const std::uint64_t q = u >> k;
+    return q >= escape ? escape + 64 : q + 1 + k;
+}
+
+/// Smallest shift s such that every x * 2^s is an integer below 2^31, or
+/// -1. Negative zero does not survive the integer round trip and also
+/// disqualifies the chunk.
+inline int integer_shift(const float* x, std::size_t n)
+{
+    int s = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::uint32_t b = std::bit_cast<std::uint32_t>(x[i]);
+        const std::uint32_t e = (b >> 23) & 0xFF;
+        std::uint32_t m = b & 0x7FFFFF;
+        if (e == 0xFF || b == 0x80000000u)
+            return -1;
+        if (e == 0 && m == 0)
+            continue;
+        int exp = e == 0 ? -149 : static_cast<int>(e) - 150;
+        if (e != 0)
+            m |= 0x800000;
+        exp += std::countr_zero(m);
+        s = std::max(s, -exp);
+        if (s > 62)
+            return -1;
+    }
+    for (std::size_t i = 0; i < n; ++i)
+        if (std::fabs(std::ldexp(static_cast<double>(x[i]), s)) >= 2147483648.0)
+            return -1;
+    return s;
+}
+
+inline void encode_integer(BitWriter& w, std::size_t n, int shift, unsigned order, const std::vector<std::int64_t>& v)
+{
+    w.put(integer, 2);
+    w.put(static_cast<unsigned>(shift), 6);
+    w.put(order, 3);
+    std::vector<std::uint64_t> u(n);
+    for (std::size_t i = 0; i < n; ++i)
+        u[i] = zigzag(v[i] - predict(v.data(), i, order));
+    for (std::size_t p = 0; p < n; p += partition) {
+        const std::size_t end = std::min(n, p + partition);
+        unsigned best_k = 0;
+        std::size_t best = SIZE_MAX;
+        for (unsigned k = 0; k < 40; ++k) {
+            std::size_t bits = 0;
+            for (std::size_t i = p; i < end; ++i)
+                bits += rice_bits(u[i], k);
+            if (bits < best)
+                best = bits, best_k = k;
+        }
+        w.put(best_k, 6);
+        for (std::size_t i = p; i < end; ++i)
+            rice_put(w, u[i], best_k);
+    }
+}
+
+inline std::size_t float_cost(const float* x, std::size_t n, unsigned order)
+{
+    std::size_t bits = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::uint32_t d = std::bit_cast<std::uint32_t>(x[i]) ^ std::bit_cast<std::uint32_t>(predict_float(x, i, order));
+        bits += 6 + (d ? 32 - std::countl_zero(d) : 0);
+    }
+    return bits;
+}
+
+inline void encode_float(BitWriter& w, const float* x, std::size_t n, unsigned order)
+{
+    w.put(floating, 2);
+    w.put(order, 3);
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::uint32_t d = std::bit_cast<std::uint32_t>(x[i]) ^ std::bit_cast<std::uint32_t>(predict_float(x, i, order));
+        const unsigned sig = d ? 32 - std::countl_zero(d) : 0;
+        w.put(sig, 6);
+        w.put(d, sig);
+    }
+}
+
+inline void encode_chunk(std::vector<std::uint8_t>& out, const float* x, std::size_t n)
+{
+    std::size_t best_bits = 2 + 32 * n;
+    enum { pick_verbatim, pick_integer, pick_float } pick = pick_verbatim;
+    unsigned best_order = 0;
+
+    const int shift = integer_shift(x, n);
+    std::vector<std::int64_t> v;
+    if (shift >= 0) {
+        v.resize(n);
+        for (std::size_t i = 0; i < n; ++i)
+            v[i] = static_cast<std::int64_t>(std::ldexp(static_cast<double>(x[i]), shift));
+        for (unsigned order = 0; order <= max_order; ++order) {
+            // Estimate with the best single Rice parameter over the chunk.
+            std::uint64_t sum = 0;
+            for (std::size_t i = 0; i < n; ++i)
+                sum += zigzag(v[i] - predict(v.data(), i, order)) >> 4;
+            const double mean = 16.0 * static_cast<double>(sum) / static_cast<double>(n) + 1.0;
+            const auto k = static_cast<unsigned>(std::max(0.0, std::floor(std::log2(mean))));
+            std::size_t bits = 11;
+            for (std::size_t i = 0; i < n; ++i)
+                bits += rice_bits(zigzag(v[i] - predict(v.data(), i, order)), k);
+            bits += 6 * ((n + partition - 1) / partition);
+            if (bits < best_bits)
+                best_bits = bits, pick = pick_integer, best_order = order;
+        }
+    }
+    for (unsigned order = 0; order <= max_order; ++order) {
+        const std::size_t bits = 5 + float_cost(x, n, order);
+        if (bits < best_bits)
+            best_bits = bits, pick = pick_float, best_order = order;
+    }
+
+    BitWriter w(out);
+    switch (pick) {
+    case pick_integer: encode_integer(w, n, shift, best_order, v); break;
+    case pick_float: encode_float(w, x, n, best_order); break;
+    case pick_verbatim:
+        w.put(verbatim, 2);
+        for (std::size_t i = 0; i < n; ++i)
+            w.put(std::bit_cast<std::uint32_t>(x[i]), 32);
+        break;
+    }
+    w.flush();
+}
+
+inline void decode_chunk(const std::uint8_t* p, const std::uint8_t* end, float* x, std::size_t n)
+{
+    BitReader r(p, end);
+    switch (static_cast<Mode>(r.get(2))) {
+    case verbatim:
+        for (std::size_t i = 0; i < n; ++i)
+            x[i] = std::bit_cast<float>(static_cast<std::uint32_t>(r.get(32)));
+        break;
+    case integer: {
+        const int shift = static_cast<int>(r.get(6));
+        const auto order = static_cast<unsigned>(r.get(3));
+        if (order > max_order)
+            throw std::runtime_error("lossless_codec: bad predictor order");
+        std::int64_t v[max_order] = {};
+        for (std::size_t p0 = 0; p0 < n; p0 += partition) {
+            const auto k = static_cast<unsigned>(r.get(6));
+            const std::size_t pend = std::min(n, p0 + partition);
+            for (std::size_t i = p0; i < pend; ++i) {
+                // v holds the last `order` integers, most recent first.
+                std::int64_t pred = 0;
+                switch (std::min<std::size_t>(order, i)) {
+                case 0: break;
+                case 1: pred = v[0]; break;
+                case 2: pred = 2 * v[0] - v[1]; break;
+                case 3: pred = 3 * v[0] - 3 * v[1] + v[2]; break;
+                default: pred = 4 * v[0] - 6 * v[1] + 4 * v[2] - v[3]; break;
+                }
+                const std::int64_t s = pred + unzigzag(rice_get(r, k));
+                for (unsigned j = max_order - 1; j > 0; --j)
+                    v[j] = v[j - 1];
+                v[0] = s;
+                x[i] = static_cast<float>(std::ldexp(static_cast<double>(s), -shift));
+            }
+        }
+        break;
+    }
+    case floating: {
+        const auto order = static_cast<unsigned>(r.get(3));
+        if (order > max_order)
+            throw std::runtime_error("lossless_codec: bad predictor order");
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto sig = static_cast<unsigned>(r.get(6));
+            const auto d = static_cast<std::uint32_t>(r.get(sig));
+            x[i] = std::bit_cast<float>(std::bit_cast<std::uint32_t>(predict_float(x, i, order)) ^ d);
+        }
+        break;
+    }
+    default: throw std::runtime_error("lossless_codec: bad chunk mode");
+    }
+}
+
+inline void put_u64(std::uint8_t* p, std::uint64_t v) { std::memcpy(p, &v, 8); }
+inline std::uint64_t get_u64(const std::uint8_t* p)
+{
+    std::uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+}
+
+} // namespace detail
+
+/// Encode `x`; chunks are encoded in parallel when a pool is given.
+inline std::vector<std::uint8_t> encode(std::span<const float> x, ThreadPool* pool = nullptr)
+{
+    const std::size_t chunks = (x.size() + chunk_samples - 1) / chunk_samples;
+    std::vector<std::vector<std::uint8_t>> coded(chunks);
+    auto work = [&](std::size_t c) {
+        const std::size_t begin = c * chunk_samples;
+        detail::encode_chunk(coded[c], x.data() + begin, std::min(chunk_samples, x.size() - begin));
+    };
+    if (pool)
+        pool->parallel_for(chunks, work);
+    else
+        for (std::size_t c = 0; c < chunks; ++c)
+            work(c);
+
+    const std::size_t header = 16 + 8 * (chunks + 1);
+    std::size_t total = header;
+    for (const auto& c : coded)
+        total += c.size();
+    std::vector<std::uint8_t> out(total);
+    const std::uint32_t head[2] = {magic, static_cast<std::uint32_t>(chunk_samples)};
+    std::memcpy(out.data(), head, 8);
+    detail::put_u64(out.data() + 8, x.size());
+    std::size_t offset = header;
+    for (std::size_t c = 0; c < chunks; ++c) {
+        detail::put_u64(out.data() + 16 + 8 * c, offset);
+        std::memcpy(out.data() + offset, coded[c].data(), coded[c].size());
+        offset += coded[c].size();
+    }
+    detail::put_u64(out.data() + 16 + 8 * chunks, offset);
+    return out;
+}
+
+/// Number of samples encoded in `blob`.
+inline std::size_t decoded_size(std::span<const std::uint8_t> blob)
+{
+    std::uint32_t head[2];
+    if (blob.size() < 24)
+        throw std::runtime_error("lossless_codec: blob too small");
+    std::memcpy(head, blob.data(), 8);
+    if (head[0] != magic || head[1] != chunk_samples)
+        throw std::runtime_error("lossless_codec: bad header");
+    return detail::get_u64(blob.data() + 8);
+}
+
+/// Decode `blob` into `out` (decoded_size() samples); chunks are decoded
+/// in parallel when a pool is given.
+inline void decode(std::span<const std::uint8_t> blob, std::span<float> out, ThreadPool* pool = nullptr)
+{
+    const std::size_t n = decoded_size(blob);
+    if (out.size() != n)
+        throw std::invalid_argument("lossless_codec: output size mismatch");
+    const std::size_t chunks = (n + chunk_samples - 1) / chunk_samples;
+    if (blob.size() < 16 + 8 * (chunks + 1))
+        throw std::runtime_error("lossless_codec: truncated index");
+    auto work = [&](std::size_t c) {
+        const std::uint64_t b = detail::get_u64(blob.data() + 16 + 8 * c);
+        const std::uint64_t e = detail::get_u64(blob.data() + 16 + 8 * (c + 1));
+        if (b > e || e > blob.size())
+            throw std::runtime_error("lossless_codec: bad chunk offset");
+        const std::size_t begin = c * chunk_samples;
+        detail::decode_chunk(blob.data() + b, blob.data() + e, out.data() + begin, std::min(chunk_samples, n - begin));
+    };
+    if (pool)
+        pool->parallel_for(chunks, work);
+    else
+        for (std::size_t c = 0; c < chunks; ++c)
+            work(c);
+}
+
+} // namespace lossless_codec
+
+} // namespace asg
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace asg {
+
+inline std::system_error sys_error(const std::string& what)
+{
+    return std::system_error(errno, std::generic_category(), what);
+}
+
+/// Owning POSIX file descriptor.
+class FileDescriptor {
+public:
+    FileDescriptor() noexcept = default;
+    explicit FileDescriptor(int fd) noexcept : fd_(fd) {}
+
+    static FileDescriptor open(const std::string& path, int flags, mode_t mode = 0644)
+    {
+        const int fd = ::open(path.c_str(), flags | O_CLOEXEC, mode);
+        if (fd < 0)
+            throw sys_error("open " + path);
+        return FileDescriptor(fd);
+    }
+
+    FileDescriptor(FileDescriptor&& o) noexcept : fd_(std::exchange(o.fd_, -1)) {}
+    FileDescriptor& operator=(FileDescriptor&& o) noexcept
+    {
+        if (this != &o) {
+            close();
+            fd_ = std::exchange(o.fd_, -1);
+        }
+        return *this;
+    }
+    ~FileDescriptor() { close(); }
+
+    int get() const noexcept { return fd_; }
+    explicit operator bool() const noexcept { return fd_ >= 0; }
+
+    std::uint64_t size() const
+    {
+        struct stat st {};
+        if (::fstat(fd_, &st) != 0)
+            throw sys_error("fstat");
+        return static_cast<std::uint64_t>(st.st_size);
+    }
+
+    void truncate(std::uint64_t size) const
+    {
+        if (::ftruncate(fd_, static_cast<off_t>(size)) != 0)
+            throw sys_error("ftruncate");
+    }
+
+    void close() noexcept
+    {
+        if (fd_ >= 0)
+            ::close(fd_);
+        fd_ = -1;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+/// A mapped window of a file. Read-only or shared-writable.
+class MappedRegion {
+public:
+    MappedRegion() noexcept = default;
+
+    MappedRegion(const FileDescriptor& fd, std::uint64_t offset, std::size_t size, bool writable)
+        : size_(size)
+    {
+        if (size == 0)
+            return;
+        const int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+        void* p = ::mmap(nullptr, size, prot, MAP_SHARED, fd.get(), static_cast<off_t>(offset));
+        if (p == MAP_FAILED)
+            throw sys_error("mmap");
+        data_ = static_cast<std::byte*>(p);
+    }
+
+    MappedRegion(MappedRegion&& o) noexcept
+        : data_(std::exchange(o.data_, nullptr)), size_(std::exchange(o.size_, 0))
+    {
+    }
+    MappedRegion& operator=(MappedRegion&& o) noexcept
+    {
+        if (this != &o) {
+            unmap();
+            data_ = std::exchange(o.data_, nullptr);
+            size_ = std::exchange(o.size_, 0);
+        }
+        return *this;
+    }
+    ~MappedRegion() { unmap(); }
+
+    std::byte* data() noexcept { return data_; }
+    const std::byte* data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+
+    /// Hint the kernel about the access pattern (MADV_SEQUENTIAL etc.).
+    void advise(int advice) const noexcept
+    {
+        if (data_)
+            ::madvise(data_, size_, advice);
+    }
+
+    void sync() const
+    {
+        if (data_ && ::msync(data_, size_, MS_SYNC) != 0)
+            throw sys_error("msync");
+    }
+
+    void unmap() noexcept
+    {
+        if (data_)
+            ::munmap(data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+private:
+    std::byte* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+/// Whole file mapped read-only.
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string& path)
+        : fd_(FileDescriptor::open(path, O_RDONLY)), region_(fd_, 0, static_cast<std::size_t>(fd_.size()), false)
+    {
+    }
+
+    const std::byte* data() const noexcept { return region_.data(); }
+    std::size_t size() const noexcept { return region_.size(); }
+    void advise(int advice) const noexcept { region_.advise(advice); }
+
+private:
+    FileDescriptor fd_;
+    MappedRegion region_;
+};
+
+} // namespace asg
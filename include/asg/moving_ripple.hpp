@@ -0,0 +1,191 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+#include <asg/rng.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+namespace asg {
+
+/// Dynamic moving ripple (spectrotemporal ripple) generator.
+///
+/// A bank of log-spaced sinusoidal carriers f_i with random phases, each
+/// amplitude-modulated by the ripple envelope
+///
+///     A_i(t) = 1 + depth * sin(theta(t) + 2 pi Omega(t) x_i),  x_i = log2(f_i / f_lo)
+///
+/// where theta advances at the temporal modulation rate omega(t) (Hz;
+/// negative values give upward-moving ripples) and Omega(t) is the
+/// spectral density in cycles/octave. For a dynamic ripple, omega and
+/// Omega follow independent smooth random trajectories (cosine
+/// interpolation between uniform random knots at `*_knot_rate` Hz); set
+/// a range to a single value for a static ripple.
+///
+/// Carriers are evaluated as complex rotators in structure-of-arrays
+/// form, in groups of `lanes` with per-lane partial sums, so the inner
+/// loop vectorises without reassociating floating-point sums. The
+/// envelope needs no per-sample transcendental: with
+/// s = sin(theta), c = cos(theta) the envelope of carrier i is
+/// 1 + depth * (s * cos(2 pi Omega x_i) + c * sin(2 pi Omega x_i)), and the
+/// per-carrier terms are refreshed once per control block of
+/// `control_block` samples.
+class MovingRipple {
+public:
+    static constexpr std::size_t lanes = 8;
+    static constexpr std::size_t control_block = 32;
+
+    struct Config {
+        double sample_rate = 48000.0;
+        std::size_t carriers = 256;
+        double f_lo = 250.0;
+        double f_hi = 8000.0;
+        float depth = 0.9f; ///< linear modulation depth in [0, 1]
+        double omega_min = -350.0, omega_max = 350.0;
+        double omega_knot_rate = 3.0;
+        double density_min = 0.0, density_max = 4.0;
+        double density_knot_rate = 6.0;
+        std::uint64_t seed = 0;
+    };
+
+    explicit MovingRipple(const Config& cfg)
+        : cfg_(cfg),
+          n_((cfg.carriers + lanes - 1) / lanes * lanes),
+          re_(n_), im_(n_), cr_(n_), sr_(n_), x_(n_), amp_(n_), w0_(n_), w1_(n_), w2_(n_),
+          rng_(cfg.seed)
+    {
+        if (cfg.carriers == 0 || cfg.f_lo <= 0.0 || cfg.f_hi < cfg.f_lo || cfg.f_hi >= cfg.sample_rate / 2)
+            throw std::invalid_argument("MovingRipple: bad carrier configuration");
+        const double pi = 3.14159265358979323846;
+        const double octaves = std::log2(cfg.f_hi / cfg.f_lo);
+        const CounterRng phases = rng_.stream(0);
+        const float gain = 1.0f / std::sqrt(static_cast<float>(cfg.carriers));
+        for (std::size_t i = 0; i < cfg.carriers; ++i) {
+            const double x = cfg.carriers > 1 ? octaves * double(i) / double(cfg.carriers - 1) : 0.0;
+            const double f = cfg.f_lo * std::exp2(x);
+            const double ph = 2.0 * pi * phases.uniform(i);
+            const double dw = 2.0 * pi * f / cfg.sample_rate;
+            re_[i] = static_cast<float>(std::cos(ph));
+            im_[i] = static_cast<float>(std::sin(ph));
+            cr_[i] = static_cast<float>(std::cos(dw));
+            sr_[i] = static_cast<float>(std::sin(dw));
+            x_[i] = static_cast<float>(x);
+            amp_[i] = gain;
+        }
+        // Padding carriers have zero amplitude and a fixed rotator.
+        for (std::size_t i = cfg.carriers; i < n_; ++i)
+            re_[i] = cr_[i] = 1.0f;
+    }
+
+    std::size_t carriers() const noexcept { return cfg_.carriers; }
+    std::uint64_t position() const noexcept { return pos_; }
+
+    /// Current temporal modulation rate (Hz) and spectral density (cyc/oct).
+    double omega() const noexcept { return omega_; }
+    double density() const noexcept { return density_; }
+
+    void render(float* out, std::size_t frames) noexcept
+    {
+        while (frames > 0) {
+            if (ctl_pos_ == control_block)
+                update_control();
+            const std::size_t n = std::min(frames, control_block - ctl_pos_);
+            render_carriers(out, n);
+            ctl_pos_ += n;
+            pos_ += n;
+            out += n;
+            frames -= n;
+        }
+    }
+
+private:
+    /// Smooth random trajectory: cosine interpolation between uniform knots.
+    double trajectory(std::uint64_t stream, double lo, double hi, double rate) const noexcept
+    {
+        if (hi <= lo || rate <= 0.0)
+            return lo;
+        const double t = static_cast<double>(pos_) / cfg_.sample_rate * rate;
+        const double k = std::floor(t);
+        const double f = t - k;
+        const CounterRng r = rng_.stream(stream);
+        const auto ki = static_cast<std::uint64_t>(k);
+        const double a = r.uniform(ki), b = r.uniform(ki + 1);
+        const double w = 0.5 - 0.5 * std::cos(3.14159265358979323846 * f);
+        return lo + (hi - lo) * (a + (b - a) * w);
+    }
+
+    void update_control() noexcept
+    {
+        const double two_pi = 6.28318530717958647692;
+        omega_ = trajectory(1, cfg_.omega_min, cfg_.omega_max, cfg_.omega_knot_rate);
+        density_ = trajectory(2, cfg_.density_min, cfg_.density_max, cfg_.density_knot_rate);
+        theta_step_c_ = static_cast<float>(std::cos(two_pi * omega_ / cfg_.sample_rate));
+        theta_step_s_ = static_cast<float>(std::sin(two_pi * omega_ / cfg_.sample_rate));
+
+        // Renormalise the envelope rotator and carriers against drift.
+        const float g = 1.5f - 0.5f * (theta_c_ * theta_c_ + theta_s_ * theta_s_);
+        theta_c_ *= g;
+        theta_s_ *= g;
+        const float depth = cfg_.depth;
+        const float k = static_cast<float>(two_pi * density_);
+        for (std::size_t i = 0; i < n_; ++i) {
+            const float m = 1.5f - 0.5f * (re_[i] * re_[i] + im_[i] * im_[i]);
+            re_[i] *= m;
+            im_[i] *= m;
+            const float phase = k * x_[i];
+            w0_[i] = amp_[i];
+            w1_[i] = amp_[i] * depth * std::cos(phase);
+            w2_[i] = amp_[i] * depth * std::sin(phase);
+        }
+        ctl_pos_ = 0;
+    }
+
+    void render_carriers(float* out, std::size_t frames) noexcept
+    {
+        float* __restrict re = re_.data();
+        float* __restrict im = im_.data();
+        const float* __restrict cr = cr_.data();
+        const float* __restrict sr = sr_.data();
+        const float* __restrict w0 = w0_.data();
+        const float* __restrict w1 = w1_.data();
+        const float* __restrict w2 = w2_.data();
+
+        for (std::size_t t = 0; t < frames; ++t) {
+            // sin/cos of the envelope phase theta.
+            const float s = theta_s_, c = theta_c_;
+            float acc[lanes] = {};
+            for (std::size_t g = 0; g < n_; g += lanes) {
+                for (std::size_t l = 0; l < lanes; ++l) {
+                    const std::size_t i = g + l;
+                    const float r = re[i] * cr[i] - im[i] * sr[i];
+                    const float q = re[i] * sr[i] + im[i] * cr[i];
+                    re[i] = r;
+                    im[i] = q;
+                    acc[l] += q * (w0[i] + s * w1[i] + c * w2[i]);
+                }
+            }
+            float sum = 0.0f;
+            for (std::size_t l = 0; l < lanes; ++l)
+                sum += acc[l];
+            out[t] = sum;
+
+            theta_c_ = c * theta_step_c_ - s * theta_step_s_;
+            theta_s_ = c * theta_step_s_ + s * theta_step_c_;
+        }
+    }
+
+    Config cfg_;
+    std::size_t n_;
+    AlignedBuffer<float> re_, im_, cr_, sr_, x_, amp_, w0_, w1_, w2_;
+    CounterRng rng_;
+    float theta_c_ = 1.0f, theta_s_ = 0.0f;
+    float theta_step_c_ = 1.0f, theta_step_s_ = 0.0f;
+    double omega_ = 0.0, density_ = 0.0;
+    std::size_t ctl_pos_ = control_block;
+    std::uint64_t pos_ = 0;
+};
+
+} // namespace asg
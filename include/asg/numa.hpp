@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace asg {
+
+/// CPU sets per NUMA node, read from sysfs.
+///
+/// On systems without /sys/devices/system/node (or non-NUMA machines)
+/// this reports a single node holding every online CPU, so callers need
+/// no special case.
+struct NumaTopology {
+    std::vector<std::vector<int>> nodes;
+
+    static std::vector<int> parse_cpulist(const std::string& list)
+    {
+        std::vector<int> cpus;
+        std::size_t i = 0;
+        while (i < list.size()) {
+            std::size_t end = list.find(',', i);
+            if (end == std::string::npos)
+                end = list.size();
+            const std::string item = list.substr(i, end - i);
+            if (!item.empty() && item != "\n") {
+                const std::size_t dash = item.find('-');
+                const int lo = std::stoi(item.substr(0, dash));
+                const int hi = dash == std::string::npos ? lo : std::stoi(item.substr(dash + 1));
+                for (int c = lo; c <= hi; ++c)
+                    cpus.push_back(c);
+            }
+            i = end + 1;
+        }
+        return cpus;
+    }
+
+    static NumaTopology detect()
+    {
+        NumaTopology t;
+        for (int n = 0;; ++n) {
+            std::ifstream f("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+            if (!f)
+                break;
+            std::string line;
+            std::getline(f, line);
+            auto cpus = parse_cpulist(line);
+            if (!cpus.empty())
+                t.nodes.push_back(std::move(cpus));
+        }
+        if (t.nodes.empty()) {
+            std::vector<int> all;
+            const unsigned n = std::thread::hardware_concurrency();
+            for (unsigned c = 0; c < (n ? n : 1); ++c)
+                all.push_back(static_cast<int>(c));
+            t.nodes.push_back(std::move(all));
+        }
+        return t;
+    }
+
+    std::size_t cpu_count() const noexcept
+    {
+        std::size_t n = 0;
+        for (const auto& cpus : nodes)
+            n += cpus.size();
+        return n;
+    }
+};
+
+/// Restrict the calling thread to `cpus`. Returns false on failure
+/// (e.g. CPUs outside the process's allowed set), leaving affinity as is.
+inline bool pin_current_thread(const std::vector<int>& cpus) noexcept
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus)
+        if (c >= 0 && c < CPU_SETSIZE)
+            CPU_SET(c, &set);
+    return ::pthread_setaffinity_np(::pthread_self(), sizeof set, &set) == 0;
+}
+
+} // namespace asg
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <asg/rng.hpp>
+#include <asg/signal_expr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace asg {
+
+/// One playback of a shared base waveform: a gain (negative = inverted
+/// polarity, as for Cue) and a time offset, applied lazily when mixed.
+/// The base is never copied; it must outlive every presentation of it.
+struct Presentation {
+    const Signal* base = nullptr;
+    float gain = 1.0f;
+    std::int64_t offset = 0; ///< samples added to the start time (may be negative)
+
+    bool inverted() const noexcept { return gain < 0.0f; }
+};
+
+enum class RovePolarity { fixed, alternate, random };
+
+/// Trial-to-trial randomisation of a presentation.
+struct RoveSpec {
+    float level_min_db = 0.0f;
+    float level_max_db = 0.0f;
+    RovePolarity polarity = RovePolarity::fixed;
+    std::int64_t offset_min = 0;
+    std::int64_t offset_max = 0;
+};
+
+/// Draws roved presentations of shared bases. Each trial's draw is a pure
+/// function of (seed, trial), so a session can be replayed or rendered
+/// out of order. Frequency roving is expressed by passing a different
+/// pre-synthesised base per trial; it is the one parameter that needs
+/// its own waveform.
+class Rover {
+public:
+    Rover(const RoveSpec& spec, std::uint64_t seed) : spec_(spec), rng_(seed)
+    {
+        if (spec.level_max_db < spec.level_min_db || spec.offset_max < spec.offset_min)
+            throw std::invalid_argument("Rover: empty range");
+    }
+
+    Presentation operator()(const Signal& base, std::uint64_t trial) const noexcept
+    {
+        const std::uint64_t c = trial * 3;
+        const float db = spec_.level_min_db + (spec_.level_max_db - spec_.level_min_db) * rng_.uniform(c);
+        float gain = std::pow(10.0f, db / 20.0f);
+        if ((spec_.polarity == RovePolarity::alternate && (trial & 1))
+            || (spec_.polarity == RovePolarity::random && (rng_.bits(c + 1) >> 63)))
+            gain = -gain;
+        const auto range = static_cast<std::uint64_t>(spec_.offset_max - spec_.offset_min) + 1;
+        const auto offset = spec_.offset_min + static_cast<std::int64_t>(rng_.bits(c + 2) % range);
+        return {&base, gain, offset};
+    }
+
+    /// Index into a set of pre-rendered bases (e.g. roved frequencies).
+    std::size_t choose(std::size_t count, std::uint64_t trial) const noexcept
+    {
+        return static_cast<std::size_t>(rng_.stream(1).bits(trial) % count);
+    }
+
+private:
+    RoveSpec spec_;
+    CounterRng rng_;
+};
+
+/// Audio-thread mixer of scheduled presentations.
+///
+/// start() claims one of a fixed set of voices; render() adds every voice
+/// that overlaps the block as a single gain multiply-add over the
+/// overlapping span of its base, so a roved trial costs the same as an
+/// unroved one and nothing is re-synthesised. Used together with the
+/// sequencer: for each Cue that render() emits, start() a presentation
+/// at cue.sample, then render the block. Nothing allocates after
+/// construction.
+class PresentationMixer {
+public:
+    explicit PresentationMixer(std::size_t max_voices = 32) : voices_(max_voices) {}
+
+    std::uint64_t position() const noexcept { return pos_; }
+
+    std::size_t active() const noexcept
+    {
+        return static_cast<std::size_t>(std::count_if(voices_.begin(), voices_.end(), [](const Voice& v) { return v.base; }));
+    }
+
+    /// Schedule `p` at absolute sample `at` (plus its offset). Returns
+    /// false if every voice is busy or the presentation is already over.
+    bool start(const Presentation& p, std::uint64_t at) noexcept
+    {
+        if (!p.base || p.base->size() == 0)
+            return false;
+        const std::int64_t begin = static_cast<std::int64_t>(at) + p.offset;
+        const std::int64_t end = begin + static_cast<std::int64_t>(p.base->size());
+        if (end <= static_cast<std::int64_t>(pos_))
+            return false;
+        for (Voice& v : voices_) {
+            if (!v.base) {
+                v = {p.base->data(), p.gain, begin, end};
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Write the next `frames` samples of the mix.
+    void render(float* out, std::size_t frames) noexcept
+    {
+        std::fill(out, out + frames, 0.0f);
+        const auto t0 = static_cast<std::int64_t>(pos_);
+        const std::int64_t t1 = t0 + static_cast<std::int64_t>(frames);
+        for (Voice& v : voices_) {
+            if (!v.base || v.begin >= t1)
+                continue;
+            const std::int64_t from = std::max(v.begin, t0);
+            const std::int64_t to = std::min(v.end, t1);
+            if (from < to)
+                mix(out + (from - t0), v.base + (from - v.begin), v.gain, static_cast<std::size_t>(to - from));
+            if (v.end <= t1)
+                v.base = nullptr;
+        }
+        pos_ += frames;
+    }
+
+    /// Drop every voice and restart the clock at `position`.
+    void reset(std::uint64_t position = 0) noexcept
+    {
+        for (Voice& v : voices_)
+            v.base = nullptr;
+        pos_ = position;
+    }
+
+private:
+    struct Voice {
+        const float* base = nullptr;
+        float gain = 0.0f;
+        std::int64_t begin = 0;
+        std::int64_t end = 0;
+    };
+
+    static void mix(float* __restrict out, const float* __restrict in, float g, std::size_t n) noexcept
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] += g * in[i];
+    }
+
+    std::vector<Voice> voices_;
+    std::uint64_t pos_ = 0;
+};
+
+} // namespace asg
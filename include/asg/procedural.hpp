@@ -0,0 +1,252 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+#include <asg/rng.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace asg {
+
+/// A stimulus described rather than stored: which generator, its seed and
+/// parameters, and its length. 48 bytes stand in for what would otherwise
+/// be seconds of pre-rendered samples, and a bank of tokens can be kept
+/// in a vector, serialised or sent across threads as plain data.
+struct ProceduralToken {
+    static constexpr std::size_t max_params = 6;
+
+    std::uint32_t generator = 0; ///< ProceduralRegistry id
+    std::uint32_t ramp = 0;      ///< raised-cosine onset/offset, samples
+    std::uint64_t seed = 0;
+    std::uint64_t length = 0;    ///< samples
+    std::array<float, max_params> params{};
+};
+
+/// Built-in generator ids and their parameters.
+enum ProceduralGenerator : std::uint32_t {
+    procedural_tone = 0,     ///< frequency Hz, peak amplitude, start phase (rad)
+    procedural_noise = 1,    ///< RMS; Gaussian
+    procedural_harmonic = 2, ///< f0 Hz, amplitude per component, lowest, highest harmonic (<= 65535); random phases
+    procedural_sam_noise = 3 ///< RMS, modulation rate Hz, depth
+};
+
+/// Generator functions by id.
+///
+/// A generator writes samples [first, first + n) of a token into `out`
+/// and must be a pure function of (token, sample index): tokens are
+/// rendered at arbitrary block offsets, in any order and on any thread,
+/// with no state kept between calls. Noise therefore comes from
+/// CounterRng keyed by the token seed and indexed by sample, and periodic
+/// signals compute their phase from the absolute index. The built-ins
+/// occupy the ProceduralGenerator ids; add() appends further generators.
+class ProceduralRegistry {
+public:
+    using Fn = void (*)(const ProceduralToken&, double sample_rate, std::uint64_t first, float* out, std::size_t n) noexcept;
+
+    explicit ProceduralRegistry(double sample_rate = 48000.0) : sample_rate_(sample_rate)
+    {
+        if (!(sample_rate > 0.0))
+            throw std::invalid_argument("ProceduralRegistry: sample rate must be positive");
+        fns_ = {&tone, &noise, &harmonic, &sam_noise};
+    }
+
+    double sample_rate() const noexcept { return sample_rate_; }
+    std::size_t size() const noexcept { return fns_.size(); }
+
+    /// Register a generator; returns its id.
+    std::uint32_t add(Fn fn)
+    {
+        if (!fn)
+            throw std::invalid_argument("ProceduralRegistry: null generator");
+        fns_.push_back(fn);
+        return static_cast<std::uint32_t>(fns_.size() - 1);
+    }
+
+    /// Samples [first, first + n) of `token`, zero past its end or for an
+    /// unknown generator, with the onset and offset ramps applied.
+    void render(const ProceduralToken& token, std::uint64_t first, float* out, std::size_t n) const noexcept
+    {
+        const std::size_t m = first < token.length ? static_cast<std::size_t>(std::min<std::uint64_t>(n, token.length - first)) : 0;
+        std::fill(out + m, out + n, 0.0f);
+        if (m == 0)
+            return;
+        if (token.generator >= fns_.size()) {
+            std::fill(out, out + m, 0.0f);
+            return;
+        }
+        fns_[token.generator](token, sample_rate_, first, out, m);
+
+        const std::uint64_t R = std::min<std::uint64_t>(token.ramp, token.length / 2);
+        const double pi2 = 1.57079632679489662;
+        for (std::uint64_t t = first; t < std::min(R, first + m); ++t) {
+            const double s = std::sin(pi2 * (double(t) + 0.5) / double(R));
+            out[t - first] *= static_cast<float>(s * s);
+        }
+        for (std::uint64_t t = std::max(first, token.length - R); t < first + m; ++t) {
+            const double s = std::sin(pi2 * (double(token.length - 1 - t) + 0.5) / double(R));
+            out[t - first] *= static_cast<float>(s * s);
+        }
+    }
+
+private:
+    static constexpr double max_harmonic = 65535.0;
+
+    /// Fractional cycles of `cycles_per_sample` at sample `t`, in double so
+    /// the phase stays exact far into a long token.
+    static double cycles(double cycles_per_sample, std::uint64_t t) noexcept
+    {
+        const double c = cycles_per_sample * static_cast<double>(t);
+        return c - std::floor(c);
+    }
+
+    static void tone(const ProceduralToken& k, double fs, std::uint64_t first, float* out, std::size_t n) noexcept
+    {
+        const double f = k.params[0] / fs;
+        const double p0 = cycles(f, first) + k.params[2] / 6.28318530717958647692;
+        const float a = k.params[1];
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = a * static_cast<float>(std::sin(6.28318530717958647692 * (p0 + f * double(i))));
+    }
+
+    static void noise(const ProceduralToken& k, double, std::uint64_t first, float* out, std::size_t n) noexcept
+    {
+        CounterRng(k.seed).fill_normal(out, n, first);
+        const float g = k.params[0];
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] *= g;
+    }
+
+    /// Harmonics lo..hi of f0, limited to those below Nyquist and to
+    /// max_harmonic so the cost of a block stays bounded on the render
+    /// thread. Parameters are range-checked in double before any integer
+    /// conversion; a non-positive or NaN f0 or an empty range is silence.
+    static void harmonic(const ProceduralToken& k, double fs, std::uint64_t first, float* out, std::size_t n) noexcept
+    {
+        std::fill(out, out + n, 0.0f);
+        const double f0 = k.params[0];
+        const double lo_h = std::max(1.0, std::floor(double(k.params[2])));
+        const double hi_h = std::min({std::floor(double(k.params[3])), std::floor(0.5 * fs / f0), max_harmonic});
+        if (!(f0 > 0.0) || !(lo_h <= hi_h))
+            return;
+        const CounterRng rng(k.seed);
+        const float a = k.params[1];
+        const auto hi = static_cast<std::uint32_t>(hi_h);
+        for (auto h = static_cast<std::uint32_t>(lo_h); h <= hi; ++h) {
+            const double f = static_cast<double>(h) * f0 / fs;
+            if (f >= 0.5)
+                break;
+            const double p0 = cycles(f, first) + rng.uniform(h);
+            for (std::size_t i = 0; i < n; ++i)
+                out[i] += a * static_cast<float>(std::sin(6.28318530717958647692 * (p0 + f * double(i))));
+        }
+    }
+
+    static void sam_noise(const ProceduralToken& k, double fs, std::uint64_t first, float* out, std::size_t n) noexcept
+    {
+        noise(k, fs, first, out, n);
+        const double f = k.params[1] / fs;
+        const double p0 = cycles(f, first);
+        const float d = k.params[2];
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] *= 1.0f + d * static_cast<float>(std::sin(6.28318530717958647692 * (p0 + f * double(i))));
+    }
+
+    double sample_rate_;
+    std::vector<Fn> fns_;
+};
+
+/// Audio-thread mixer of procedural tokens, the just-in-time counterpart
+/// of PresentationMixer: each block renders only the part of every active
+/// token that overlaps it, straight from the generator, so playback
+/// starts as quickly as from a pre-rendered buffer with nothing stored.
+/// Nothing allocates after construction.
+class ProceduralMixer {
+public:
+    ProceduralMixer(const ProceduralRegistry& registry, std::size_t max_voices = 32, std::size_t max_block = 4096)
+        : registry_(&registry), voices_(max_voices), scratch_(max_block)
+    {
+        if (max_block == 0)
+            throw std::invalid_argument("ProceduralMixer: max_block must be positive");
+    }
+
+    std::uint64_t position() const noexcept { return pos_; }
+
+    std::size_t active() const noexcept
+    {
+        return static_cast<std::size_t>(std::count_if(voices_.begin(), voices_.end(), [](const Voice& v) { return v.live; }));
+    }
+
+    /// Schedule `token` at absolute sample `at` with `gain`. Returns false
+    /// if every voice is busy or the token is already over.
+    bool start(const ProceduralToken& token, std::uint64_t at, float gain = 1.0f) noexcept
+    {
+        if (token.length == 0 || at + token.length <= pos_)
+            return false;
+        for (Voice& v : voices_) {
+            if (!v.live) {
+                v = {token, at, gain, true};
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Write the next `frames` samples of the mix.
+    void render(float* out, std::size_t frames) noexcept
+    {
+        std::fill(out, out + frames, 0.0f);
+        for (std::size_t done = 0; done < frames;) {
+            const std::size_t n = std::min(frames - done, scratch_.size());
+            const std::uint64_t t0 = pos_ + done, t1 = t0 + n;
+            for (Voice& v : voices_) {
+                if (!v.live || v.at >= t1)
+                    continue;
+                const std::uint64_t from = std::max(v.at, t0);
+                const std::uint64_t to = std::min(v.at + v.token.length, t1);
+                if (from < to) {
+                    const auto m = static_cast<std::size_t>(to - from);
+                    registry_->render(v.token, from - v.at, scratch_.data(), m);
+                    mix(out + done + (from - t0), scratch_.data(), v.gain, m);
+                }
+                if (v.at + v.token.length <= t1)
+                    v.live = false;
+            }
+            done += n;
+        }
+        pos_ += frames;
+    }
+
+    /// Drop every voice and restart the clock at `position`.
+    void reset(std::uint64_t position = 0) noexcept
+    {
+        for (Voice& v : voices_)
+            v.live = false;
+        pos_ = position;
+    }
+
+private:
+    struct Voice {
+        ProceduralToken token;
+        std::uint64_t at = 0;
+        float gain = 0.0f;
+        bool live = false;
+    };
+
+    static void mix(float* __restrict out, const float* __restrict in, float g, std::size_t n) noexcept
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] += g * in[i];
+    }
+
+    const ProceduralRegistry* registry_;
+    std::vector<Voice> voices_;
+    AlignedBuffer<float> scratch_;
+    std::uint64_t pos_ = 0;
+};
+
+} // namespace asg
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace asg {
+
+/// Counter-based random number generator.
+///
+/// Every draw is a pure function of (key, counter), so any sample of a
+/// noise stream can be regenerated at random access, blocks can be
+/// rendered out of order or on different threads, and independent
+/// streams are obtained by deriving new keys rather than by sharing
+/// state. The mixing function is the SplitMix64 finaliser applied to
+/// key + counter * golden, i.e. SplitMix64 evaluated at an arbitrary index.
+class CounterRng {
+public:
+    static constexpr std::uint64_t golden = 0x9E3779B97F4A7C15ull;
+
+    constexpr CounterRng() noexcept = default;
+    constexpr explicit CounterRng(std::uint64_t seed) noexcept : key_(mix(seed ^ golden)) {}
+
+    static constexpr std::uint64_t mix(std::uint64_t z) noexcept
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    constexpr std::uint64_t key() const noexcept { return key_; }
+
+    /// Independent sub-stream, e.g. one per channel or per talker.
+    constexpr CounterRng stream(std::uint64_t id) const noexcept
+    {
+        CounterRng r;
+        r.key_ = mix(key_ ^ mix(id * golden + 0x632BE59BD9B4E019ull));
+        return r;
+    }
+
+    constexpr std::uint64_t bits(std::uint64_t counter) const noexcept
+    {
+        return mix(key_ + counter * golden);
+    }
+
+    /// Uniform in [0, 1) with 24 bits of resolution.
+    constexpr float uniform(std::uint64_t counter) const noexcept
+    {
+        return static_cast<float>(bits(counter) >> 40) * 0x1.0p-24f;
+    }
+
+    /// Uniform in [-1, 1).
+    constexpr float uniform_pm(std::uint64_t counter) const noexcept
+    {
+        return static_cast<float>(static_cast<std::int64_t>(bits(counter)) >> 40) * 0x1.0p-23f;
+    }
+
+    /// Standard normal draw (Box-Muller on the two halves of one word).
+    float normal(std::uint64_t counter) const noexcept
+    {
+        const std::uint64_t b = bits(counter);
+        // u1 in (0, 1] so the log is finite.
+        const float u1 = (static_cast<float>(b >> 40) + 1.0f) * 0x1.0p-24f;
+        const float u2 = static_cast<float>((b >> 8) & 0xFFFFFFu) * 0x1.0p-24f;
+        return std::sqrt(-2.0f * std::log(u1)) * std::cos(6.28318530717958647692f * u2);
+    }
+
+    void fill_uniform_pm(float* out, std::size_t n, std::uint64_t first) const noexcept
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = uniform_pm(first + i);
+    }
+
+    void fill_normal(float* out, std::size_t n, std::uint64_t first) const noexcept
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = normal(first + i);
+    }
+
+private:
+    std::uint64_t key_ = 0;
+};
+
+} // namespace asg
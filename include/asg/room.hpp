@@ -0,0 +1,315 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+#include <asg/convolver.hpp>
+#include <asg/rng.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+namespace asg {
+
+struct Vec3 {
+    double x = 0.0, y = 0.0, z = 0.0;
+};
+
+/// Rectangular room for the image-source model.
+struct ShoeboxRoom {
+    Vec3 size{6.0, 4.0, 3.0};                  ///< metres
+    std::array<double, 6> reflection{0.85, 0.85, 0.85, 0.85, 0.7, 0.9}; ///< pressure; x0 x1 y0 y1 z0 z1
+    double sample_rate = 48000.0;
+    double speed_of_sound = 343.0;
+    int max_order = 12;                        ///< image order cap for early reflections
+    double mixing_time = 0.08;                 ///< s; early/late transition
+    double length = 1.0;                       ///< IR length, s
+    std::uint64_t seed = 1;                    ///< late-tail noise
+
+    /// Sabine reverberation time from the wall reflection coefficients.
+    double rt60() const noexcept
+    {
+        const double lx = size.x, ly = size.y, lz = size.z;
+        const double area[6] = {ly * lz, ly * lz, lx * lz, lx * lz, lx * ly, lx * ly};
+        double absorption = 0.0;
+        for (int w = 0; w < 6; ++w)
+            absorption += area[w] * (1.0 - reflection[w] * reflection[w]);
+        return 0.161 * lx * ly * lz / std::max(absorption, 1e-9);
+    }
+};
+
+/// Room impulse response from `src` to `lst`: image sources up to
+/// max_order arriving before the mixing time, then an exponentially
+/// decaying noise tail at the Sabine RT60 whose level continues the
+/// early energy. Amplitudes are 1/r (1 at 1 m); arrivals are placed with
+/// a windowed-sinc fractional delay. The tail depends only on the room
+/// and seed, so IRs of nearby positions share it and blend cleanly.
+inline void render_room_ir(const ShoeboxRoom& room, Vec3 src, Vec3 lst, std::span<float> out)
+{
+    const double fs = room.sample_rate;
+    const double L[3] = {room.size.x, room.size.y, room.size.z};
+    const auto clamp_in = [&](Vec3 v) {
+        const double eps = 1e-3;
+        return Vec3{std::clamp(v.x, eps, L[0] - eps), std::clamp(v.y, eps, L[1] - eps), std::clamp(v.z, eps, L[2] - eps)};
+    };
+    src = clamp_in(src);
+    lst = clamp_in(lst);
+    const double s[3] = {src.x, src.y, src.z};
+    const double l[3] = {lst.x, lst.y, lst.z};
+    std::fill(out.begin(), out.end(), 0.0f);
+
+    const std::size_t n = out.size();
+    const std::size_t mix = std::min(n, static_cast<std::size_t>(room.mixing_time * fs));
+    const std::size_t fade = std::min<std::size_t>(static_cast<std::size_t>(0.005 * fs), n - mix);
+    constexpr int taps = 4; // sinc half-width
+    const double pi = 3.14159265358979323846;
+
+    // Allen & Berkley images: lattice index n and mirror parity q per axis,
+    // with |n - q| reflections off the wall at 0 and |n| off the far wall.
+    // An axis contributes at least 2|n| - 1 reflections, which bounds n.
+    const int N = room.max_order;
+    const int M = N / 2 + 1;
+    for (int nx = -M; nx <= M; ++nx)
+        for (int ny = -M; ny <= M; ++ny)
+            for (int nz = -M; nz <= M; ++nz)
+                for (int q = 0; q < 8; ++q) {
+                    const int nn[3] = {nx, ny, nz};
+                    int order = 0;
+                    double gain = 1.0, d2 = 0.0;
+                    for (int a = 0; a < 3; ++a) {
+                        const int qa = (q >> a) & 1;
+                        const int r0 = std::abs(nn[a] - qa), r1 = std::abs(nn[a]);
+                        order += r0 + r1;
+                        gain *= std::pow(room.reflection[2 * a], r0) * std::pow(room.reflection[2 * a + 1], r1);
+                        const double img = (1 - 2 * qa) * s[a] + 2.0 * nn[a] * L[a];
+                        d2 += (img - l[a]) * (img - l[a]);
+                    }
+                    if (order > N)
+                        continue;
+                    const double r = std::max(std::sqrt(d2), 0.05);
+                    const double t = r / room.speed_of_sound * fs;
+                    if (t >= static_cast<double>(mix + fade))
+                        continue;
+                    const double amp = gain / r;
+                    const auto c = static_cast<std::int64_t>(std::floor(t));
+                    for (std::int64_t k = c - taps + 1; k <= c + taps; ++k) {
+                        if (k < 0 || k >= static_cast<std::int64_t>(mix + fade))
+                            continue;
+                        const double x = static_cast<double>(k) - t;
+                        const double sinc = std::abs(x) < 1e-9 ? 1.0 : std::sin(pi * x) / (pi * x);
+                        const double win = std::abs(x) < taps ? 0.5 + 0.5 * std::cos(pi * x / taps) : 0.0;
+                        out[static_cast<std::size_t>(k)] += static_cast<float>(amp * sinc * win);
+                    }
+                }
+
+    if (mix >= n)
+        return;
+
+    // Tail level: mean early energy over the 20 ms before the mixing time.
+    const std::size_t win = std::min(mix, static_cast<std::size_t>(0.02 * fs));
+    double energy = 0.0;
+    for (std::size_t i = mix - win; i < mix; ++i)
+        energy += double(out[i]) * out[i];
+    const double a0 = win > 0 ? std::sqrt(energy / double(win)) : 0.0;
+    const double decay = std::pow(10.0, -3.0 / (room.rt60() * fs)); // amplitude per sample
+    const CounterRng rng(room.seed);
+    double env = a0;
+    for (std::size_t i = mix; i < n; ++i) {
+        const double ramp = i - mix < fade ? (double(i - mix) + 0.5) / double(fade) : 1.0;
+        out[i] = static_cast<float>((1.0 - ramp) * out[i] + ramp * env * rng.normal(i));
+        env *= decay;
+    }
+}
+
+/// Room IRs on a position grid, computed on first use and kept.
+///
+/// Listener positions snap to the nearest grid point; source positions are
+/// blended trilinearly from the eight surrounding grid IRs, so a moving
+/// source reuses cached IRs and each new position costs a weighted sum
+/// rather than an image-source run. The grid spacing bounds how far apart
+/// the blended arrivals are (0.1 m is about 14 samples at 48 kHz).
+class RoomIrCache {
+public:
+    RoomIrCache(const ShoeboxRoom& room, double grid = 0.1)
+        : room_(room), grid_(grid), length_(static_cast<std::size_t>(room.length * room.sample_rate))
+    {
+        if (!(grid > 0.0) || length_ == 0)
+            throw std::invalid_argument("RoomIrCache: grid and IR length must be positive");
+    }
+
+    const ShoeboxRoom& room() const noexcept { return room_; }
+    std::size_t length() const noexcept { return length_; }
+
+    std::size_t size() const
+    {
+        std::lock_guard lock(mutex_);
+        return irs_.size();
+    }
+
+    /// IR between two grid points (positions are rounded to the grid).
+    std::shared_ptr<const std::vector<float>> grid_ir(Vec3 src, Vec3 lst)
+    {
+        return lookup(cell(src, true), cell(lst, true));
+    }
+
+    /// IR for an arbitrary source position, listener snapped to the grid.
+    void ir(Vec3 src, Vec3 lst, std::span<float> out)
+    {
+        const Cell l = cell(lst, true);
+        const Cell s0 = cell(src, false);
+        const double f[3] = {src.x / grid_ - s0[0], src.y / grid_ - s0[1], src.z / grid_ - s0[2]};
+        const std::size_t n = std::min(out.size(), length_);
+        std::fill(out.begin(), out.end(), 0.0f);
+        for (int corner = 0; corner < 8; ++corner) {
+            double w = 1.0;
+            Cell c = s0;
+            for (int a = 0; a < 3; ++a) {
+                const int bit = (corner >> a) & 1;
+                c[a] += bit;
+                w *= bit ? f[a] : 1.0 - f[a];
+            }
+            if (w < 1e-6)
+                continue;
+            const auto ir = lookup(c, l);
+            const float g = static_cast<float>(w);
+            const float* __restrict p = ir->data();
+            float* __restrict o = out.data();
+            for (std::size_t i = 0; i < n; ++i)
+                o[i] += g * p[i];
+        }
+    }
+
+private:
+    using Cell = std::array<std::int64_t, 3>;
+
+    /// Grid cell of `v`: nearest point, or the lower corner.
+    Cell cell(Vec3 v, bool nearest) const noexcept
+    {
+        const auto q = [&](double c) {
+            return static_cast<std::int64_t>(nearest ? std::round(c / grid_) : std::floor(c / grid_));
+        };
+        return {q(v.x), q(v.y), q(v.z)};
+    }
+
+    std::shared_ptr<const std::vector<float>> lookup(const Cell& s, const Cell& l)
+    {
+        const auto key = std::make_tuple(s[0], s[1], s[2], l[0], l[1], l[2]);
+        {
+            std::lock_guard lock(mutex_);
+            if (auto it = irs_.find(key); it != irs_.end())
+                return it->second;
+        }
+        auto ir = std::make_shared<std::vector<float>>(length_);
+        render_room_ir(room_, Vec3{s[0] * grid_, s[1] * grid_, s[2] * grid_}, Vec3{l[0] * grid_, l[1] * grid_, l[2] * grid_}, *ir);
+        std::lock_guard lock(mutex_);
+        return irs_.emplace(key, std::move(ir)).first->second;
+    }
+
+    ShoeboxRoom room_;
+    double grid_;
+    std::size_t length_;
+    mutable std::mutex mutex_;
+    std::map<std::tuple<std::int64_t, std::int64_t, std::int64_t, std::int64_t, std::int64_t, std::int64_t>,
+             std::shared_ptr<const std::vector<float>>>
+        irs_;
+};
+
+/// Mono source in a simulated room: cached, interpolated IRs rendered
+/// through a partitioned convolver.
+///
+/// move() runs on the control thread (IR blend and partition FFTs);
+/// process() runs on the audio thread in convolver blocks and crossfades
+/// to the new IR over one block when the source or listener has moved.
+///
+/// By default process() takes whole blocks only, with no added latency.
+/// With `buffered` set it takes any frame count: input is collected into
+/// blocks internally and output is delayed by exactly one block. Use that
+/// for hosts whose callback size is not a multiple of the block, the
+/// filtering counterpart of driving a generator through BlockAdapter.
+class RoomRenderer {
+public:
+    struct Config {
+        ShoeboxRoom room;
+        double grid = 0.1;
+        std::size_t block = 256;
+        bool buffered = false; ///< accept any frame count, one block of latency
+    };
+
+    explicit RoomRenderer(const Config& cfg)
+        : cache_(cfg.room, cfg.grid),
+          convolver_({cfg.block, cache_.length(), 3}),
+          scratch_(cache_.length()),
+          fifo_(cfg.buffered ? cfg.block : 0),
+          buffered_(cfg.buffered)
+    {
+    }
+
+    RoomIrCache& cache() noexcept { return cache_; }
+    std::size_t block() const noexcept { return convolver_.block(); }
+
+    /// Output delay in samples on top of the room's own propagation delay.
+    std::size_t latency() const noexcept { return buffered_ ? convolver_.block() : 0; }
+
+    /// Control thread. Returns false if the audio thread has not yet taken
+    /// up the previous positions; call again later.
+    bool move(Vec3 src, Vec3 lst)
+    {
+        cache_.ir(src, lst, scratch_);
+        return convolver_.set_ir(scratch_);
+    }
+
+    /// Audio thread. Unbuffered, `frames` must be a multiple of block():
+    /// a partial block cannot be convolved without delaying the output,
+    /// so it is a precondition violation (asserted in debug builds) and
+    /// its output is zeroed. `in` and `out` may alias.
+    void process(const float* in, float* out, std::size_t frames) noexcept
+    {
+        const std::size_t B = convolver_.block();
+        if (buffered_) {
+            process_buffered(in, out, frames);
+            return;
+        }
+        assert(frames % B == 0 && "RoomRenderer: frames must be a multiple of block(); set Config::buffered");
+        const std::size_t whole = frames - frames % B;
+        for (std::size_t i = 0; i < whole; i += B)
+            convolver_.process(in + i, out + i);
+        std::fill(out + whole, out + frames, 0.0f);
+    }
+
+private:
+    /// fifo_[0, fill_) holds input collected towards the next block and
+    /// fifo_[fill_, B) the previous block's output still to be returned;
+    /// each sample trades places with its input, so in and out may alias.
+    void process_buffered(const float* in, float* out, std::size_t frames) noexcept
+    {
+        const std::size_t B = convolver_.block();
+        float* f = fifo_.data();
+        for (std::size_t i = 0; i < frames; ++i) {
+            const float x = in[i];
+            out[i] = f[fill_];
+            f[fill_] = x;
+            if (++fill_ == B) {
+                convolver_.process(f, f);
+                fill_ = 0;
+            }
+        }
+    }
+
+    RoomIrCache cache_;
+    PartitionedConvolver convolver_;
+    std::vector<float> scratch_;
+    AlignedBuffer<float> fifo_;
+    std::size_t fill_ = 0;
+    bool buffered_;
+};
+
+} // namespace asg
@@ -0,0 +1,419 @@
+#pragma once
+
+#include <asg/rng.hpp>
+#include <asg/spsc_queue.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace asg {
+
+/// A stimulus onset requested by a sequence, stamped with the absolute
+/// sample position at which it must start.
+struct Cue {
+    std::uint64_t sample = 0;
+    std::uint32_t stimulus = 0;
+    float gain = 1.0f;
+};
+
+/// A subject response as seen by a sequence.
+struct Response {
+    std::int32_t code = 0;
+    std::uint64_t sample = 0;
+    bool timed_out = false;
+};
+
+/// Fixed-size slab pool for coroutine frames.
+///
+/// Allocation and release are lock-free so that frames may be created on
+/// a control thread and destroyed on the render thread. The free list is
+/// an index-based Treiber stack with a generation tag against ABA.
+class FramePool {
+public:
+    FramePool(std::size_t frame_bytes, std::size_t count)
+        : stride_((frame_bytes + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1)),
+          count_(count),
+          next_(count)
+    {
+        if (count == 0 || count >= npos)
+            throw std::invalid_argument("FramePool: bad frame count");
+        storage_ = static_cast<std::byte*>(::operator new(stride_ * count, std::align_val_t{alignof(std::max_align_t)}));
+        for (std::size_t i = 0; i < count; ++i)
+            next_[i].store(static_cast<std::uint32_t>(i + 1 < count ? i + 1 : npos), std::memory_order_relaxed);
+        head_.store(0, std::memory_order_relaxed);
+    }
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    ~FramePool() { ::operator delete(storage_, std::align_val_t{alignof(std::max_align_t)}); }
+
+    std::size_t frame_bytes() const noexcept { return stride_; }
+    std::size_t capacity() const noexcept { return count_; }
+
+    /// Returns nullptr when n exceeds the frame size or the pool is empty.
+    void* allocate(std::size_t n) noexcept
+    {
+        if (n > stride_)
+            return nullptr;
+        std::uint64_t head = head_.load(std::memory_order_acquire);
+        for (;;) {
+            const auto idx = static_cast<std::uint32_t>(head);
+            if (idx == npos)
+                return nullptr;
+            const std::uint64_t next = next_[idx].load(std::memory_order_relaxed);
+            const std::uint64_t desired = ((head >> 32) + 1) << 32 | next;
+            if (head_.compare_exchange_weak(head, desired, std::memory_order_acq_rel, std::memory_order_acquire))
+                return storage_ + std::size_t(idx) * stride_;
+        }
+    }
+
+    void deallocate(void* p) noexcept
+    {
+        const auto idx = static_cast<std::uint32_t>((static_cast<std::byte*>(p) - storage_) / stride_);
+        std::uint64_t head = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            next_[idx].store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+            const std::uint64_t desired = ((head >> 32) + 1) << 32 | idx;
+            if (head_.compare_exchange_weak(head, desired, std::memory_order_release, std::memory_order_relaxed))
+                return;
+        }
+    }
+
+private:
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    std::size_t stride_;
+    std::size_t count_;
+    std::byte* storage_ = nullptr;
+    std::vector<std::atomic<std::uint32_t>> next_;
+    std::atomic<std::uint64_t> head_{npos};
+};
+
+class Sequencer;
+
+/// Coroutine type for trial scripts.
+///
+/// A sequence must take `Sequencer&` as its first parameter; its frame is
+/// then carved from that sequencer's FramePool instead of the heap. If the
+/// pool is exhausted or the frame is too large, the returned Sequence is
+/// empty (operator bool is false).
+///
+///     asg::Sequence trial(asg::Sequencer& s, std::uint32_t a, std::uint32_t b)
+///     {
+///         auto r = co_await s.wait_response(s.ms(3000));
+///         co_await s.play(a, 1.0f, s.ms(200));
+///         co_await s.wait(s.ms(500) + s.jitter(s.ms(50)));
+///         co_await s.play(b);
+///     }
+class Sequence {
+public:
+    struct promise_type {
+        template <typename... Args>
+        explicit promise_type(Sequencer& s, Args&...) noexcept : seq(&s)
+        {
+        }
+
+        template <typename... Args>
+        static void* operator new(std::size_t n, Sequencer& s, Args&...) noexcept;
+
+        static void operator delete(void* p, std::size_t) noexcept
+        {
+            auto* hdr = static_cast<FramePool**>(static_cast<void*>(static_cast<std::byte*>(p) - header));
+            (*hdr)->deallocate(hdr);
+        }
+
+        static Sequence get_return_object_on_allocation_failure() noexcept { return Sequence{}; }
+
+        Sequence get_return_object() noexcept
+        {
+            return Sequence{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        // Trial scripts run on the render thread; there is nobody to
+        // propagate an exception to.
+        void unhandled_exception() noexcept { std::terminate(); }
+
+        Sequencer* seq;
+        std::uint64_t wake = 0;
+        bool awaiting_response = false;
+        Response response{};
+
+        static constexpr std::size_t header = alignof(std::max_align_t);
+    };
+
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    Sequence() noexcept = default;
+    Sequence(Sequence&& o) noexcept : h_(std::exchange(o.h_, {})) {}
+    Sequence& operator=(Sequence&& o) noexcept
+    {
+        if (this != &o) {
+            reset();
+            h_ = std::exchange(o.h_, {});
+        }
+        return *this;
+    }
+    ~Sequence() { reset(); }
+
+    explicit operator bool() const noexcept { return static_cast<bool>(h_); }
+
+    handle_type release() noexcept { return std::exchange(h_, {}); }
+
+private:
+    explicit Sequence(handle_type h) noexcept : h_(h) {}
+
+    void reset() noexcept
+    {
+        if (h_)
+            h_.destroy();
+        h_ = {};
+    }
+
+    handle_type h_;
+};
+
+/// Drives trial sequences from the render thread's sample clock.
+///
+/// render() is called once per audio block. Every suspended sequence
+/// whose wake-up time falls inside the block is resumed with now() equal
+/// to that exact sample, so cues are sample-accurate regardless of block
+/// size. After construction neither render() nor the awaitables allocate.
+///
+/// start() and respond() are single-producer: call each from at most one
+/// non-render thread (they may be the same thread).
+class Sequencer {
+public:
+    struct Config {
+        double sample_rate = 48000.0;
+        std::size_t frame_bytes = 1024;  ///< upper bound on one coroutine frame
+        std::size_t max_frames = 64;     ///< pooled frames, i.e. live sequences
+        std::size_t max_active = 64;     ///< sequences scheduled at once
+        std::size_t queue_capacity = 64; ///< pending starts and responses
+        std::uint64_t seed = 0;          ///< seed for jitter()/uniform()
+    };
+
+    explicit Sequencer(const Config& cfg)
+        : cfg_(cfg),
+          pool_(cfg.frame_bytes + Sequence::promise_type::header, cfg.max_frames),
+          starts_(cfg.queue_capacity),
+          responses_(cfg.queue_capacity),
+          rng_(cfg.seed)
+    {
+        active_.reserve(cfg.max_active);
+    }
+
+    Sequencer(const Sequencer&) = delete;
+    Sequencer& operator=(const Sequencer&) = delete;
+
+    ~Sequencer()
+    {
+        for (auto h : active_)
+            h.destroy();
+        // Queued but never started: their frames still belong to pool_.
+        while (auto s = starts_.try_pop())
+            s->destroy();
+    }
+
+    FramePool& pool() noexcept { return pool_; }
+    double sample_rate() const noexcept { return cfg_.sample_rate; }
+
+    /// Queue a sequence to begin at the start of the next rendered block.
+    /// Returns false (and destroys the sequence) if it is empty or the
+    /// queue is full.
+    bool start(Sequence s) noexcept
+    {
+        if (!s)
+            return false;
+        auto h = s.release();
+        if (!starts_.try_push(h)) {
+            h.destroy();
+            return false;
+        }
+        return true;
+    }
+
+    /// Deliver a response observed at absolute sample position `sample`.
+    /// Responses stamped in the past are delivered at the next block start.
+    bool respond(std::int32_t code, std::uint64_t sample = 0) noexcept
+    {
+        return responses_.try_push(Response{code, sample, false});
+    }
+
+    /// Advance the clock by `frames` samples, resuming due sequences.
+    /// Cues are written to `cues`; the number written is returned and any
+    /// excess is counted in dropped_cues().
+    std::size_t render(std::size_t frames, std::span<Cue> cues) noexcept
+    {
+        cues_ = cues;
+        n_cues_ = 0;
+        const std::uint64_t end = clock_ + frames;
+
+        while (active_.size() < cfg_.max_active) {
+            auto* h = starts_.front();
+            if (!h)
+                break;
+            h->promise().wake = clock_;
+            active_.push_back(*h);
+            starts_.pop();
+        }
+
+        for (;;) {
+            std::size_t next = active_.size();
+            std::uint64_t t = end;
+            for (std::size_t i = 0; i < active_.size(); ++i) {
+                const std::uint64_t w = active_[i].promise().wake;
+                if (w < t) {
+                    t = w;
+                    next = i;
+                }
+            }
+
+            if (Response* r = responses_.front()) {
+                const std::uint64_t rs = std::max(r->sample, clock_);
+                if (rs < end && rs <= t) {
+                    for (auto h : active_) {
+                        auto& p = h.promise();
+                        if (p.awaiting_response) {
+                            p.awaiting_response = false;
+                            p.response = Response{r->code, rs, false};
+                            p.wake = rs;
+                        }
+                    }
+                    responses_.pop();
+                    continue;
+                }
+            }
+
+            if (next == active_.size())
+                break;
+
+            auto h = active_[next];
+            now_ = std::max(t, clock_);
+            h.resume();
+            if (h.done()) {
+                h.destroy();
+                active_[next] = active_.back();
+                active_.pop_back();
+            }
+        }
+
+        clock_ = end;
+        now_ = end;
+        return n_cues_;
+    }
+
+    /// Sample position of the current resumption (inside a sequence) or of
+    /// the next block start (outside).
+    std::uint64_t now() const noexcept { return now_; }
+    std::size_t active() const noexcept { return active_.size(); }
+    std::uint64_t dropped_cues() const noexcept { return dropped_; }
+
+    std::uint64_t ms(double milliseconds) const noexcept
+    {
+        return static_cast<std::uint64_t>(milliseconds * 1e-3 * cfg_.sample_rate + 0.5);
+    }
+
+    /// Deterministic uniform draw in [lo, hi).
+    float uniform(float lo, float hi) noexcept { return lo + (hi - lo) * rng_.uniform(draws_++); }
+
+    /// Deterministic integer jitter in [0, span] samples.
+    std::uint64_t jitter(std::uint64_t span) noexcept
+    {
+        return static_cast<std::uint64_t>(rng_.uniform(draws_++) * static_cast<float>(span + 1));
+    }
+
+    // --- awaitables ------------------------------------------------------
+
+    struct WaitAwaiter {
+        std::uint64_t until;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(Sequence::handle_type h) const noexcept { h.promise().wake = until; }
+        void await_resume() const noexcept {}
+    };
+
+    struct ResponseAwaiter {
+        std::uint64_t deadline;
+        Sequence::handle_type h{};
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(Sequence::handle_type handle) noexcept
+        {
+            h = handle;
+            auto& p = h.promise();
+            p.awaiting_response = true;
+            p.wake = deadline;
+        }
+        Response await_resume() const noexcept
+        {
+            auto& p = h.promise();
+            if (p.awaiting_response) {
+                p.awaiting_response = false;
+                return Response{0, p.seq->now(), true};
+            }
+            return p.response;
+        }
+    };
+
+    /// Suspend for `samples` samples.
+    WaitAwaiter wait(std::uint64_t samples) const noexcept { return {now_ + samples}; }
+
+    /// Suspend until absolute sample position `sample` (no-op if past).
+    WaitAwaiter wait_until(std::uint64_t sample) const noexcept { return {std::max(sample, now_)}; }
+
+    /// Emit a cue at now() and suspend for `duration` samples.
+    WaitAwaiter play(std::uint32_t stimulus, float gain = 1.0f, std::uint64_t duration = 0) noexcept
+    {
+        if (n_cues_ < cues_.size())
+            cues_[n_cues_++] = Cue{now_, stimulus, gain};
+        else
+            ++dropped_;
+        return {now_ + duration};
+    }
+
+    /// Suspend until a response arrives or `timeout` samples elapse.
+    ResponseAwaiter wait_response(std::uint64_t timeout = std::numeric_limits<std::uint64_t>::max()) const noexcept
+    {
+        const std::uint64_t max = std::numeric_limits<std::uint64_t>::max();
+        return {timeout > max - now_ ? max : now_ + timeout};
+    }
+
+private:
+    Config cfg_;
+    FramePool pool_;
+    SpscQueue<Sequence::handle_type> starts_;
+    SpscQueue<Response> responses_;
+    std::vector<Sequence::handle_type> active_;
+    CounterRng rng_;
+    std::uint64_t draws_ = 0;
+    std::uint64_t clock_ = 0;
+    std::uint64_t now_ = 0;
+    std::span<Cue> cues_;
+    std::size_t n_cues_ = 0;
+    std::uint64_t dropped_ = 0;
+};
+
+template <typename... Args>
+void* Sequence::promise_type::operator new(std::size_t n, Sequencer& s, Args&...) noexcept
+{
+    void* p = s.pool().allocate(n + header);
+    if (!p)
+        return nullptr;
+    *static_cast<FramePool**>(p) = &s.pool();
+    return static_cast<std::byte*>(p) + header;
+}
+
+} // namespace asg
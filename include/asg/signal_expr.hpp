@@ -0,0 +1,268 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace asg {
+
+class Signal;
+
+/// Expression templates for sample-wise stimulus arithmetic.
+///
+/// An expression such as `a * env + b * gain` over Signals, spans and
+/// scalars builds a tree of small value types instead of computing
+/// anything; assigning it to a Signal (or evaluate()-ing it into a span)
+/// runs one loop that computes every output sample from the leaves
+/// directly. No intermediate buffers are allocated, each input is read
+/// once, and the loop body is a straight-line expression the compiler
+/// vectorises.
+///
+/// Leaves hold pointers, not copies: an expression must be evaluated
+/// before the buffers it refers to go away, so keep expressions inline
+/// rather than storing them with `auto`.
+namespace expr {
+
+/// A buffer leaf.
+struct Leaf {
+    const float* data;
+    std::size_t n;
+
+    float operator[](std::size_t i) const noexcept { return data[i]; }
+    std::size_t size() const noexcept { return n; }
+};
+
+/// A scalar leaf, broadcast to any length.
+struct Constant {
+    float value;
+
+    float operator[](std::size_t) const noexcept { return value; }
+};
+
+template <typename Op, typename L, typename R>
+struct Binary;
+template <typename Op, typename E>
+struct Unary;
+
+template <typename T>
+struct is_node : std::false_type {};
+template <>
+struct is_node<Leaf> : std::true_type {};
+template <>
+struct is_node<Constant> : std::true_type {};
+template <typename Op, typename L, typename R>
+struct is_node<Binary<Op, L, R>> : std::true_type {};
+template <typename Op, typename E>
+struct is_node<Unary<Op, E>> : std::true_type {};
+
+/// Length of a node; 0 for pure broadcasts (constants).
+template <typename E>
+std::size_t extent(const E& e) noexcept
+{
+    if constexpr (std::is_same_v<E, Constant>)
+        return 0;
+    else
+        return e.size();
+}
+
+template <typename Op, typename L, typename R>
+struct Binary {
+    L l;
+    R r;
+    std::size_t n;
+
+    Binary(L l_, R r_) : l(l_), r(r_)
+    {
+        const std::size_t a = extent(l), b = extent(r);
+        if (a && b && a != b)
+            throw std::length_error("signal expression: operand lengths differ");
+        n = a ? a : b;
+    }
+
+    float operator[](std::size_t i) const noexcept { return Op::apply(l[i], r[i]); }
+    std::size_t size() const noexcept { return n; }
+};
+
+template <typename Op, typename E>
+struct Unary {
+    E e;
+
+    float operator[](std::size_t i) const noexcept { return Op::apply(e[i]); }
+    std::size_t size() const noexcept { return extent(e); }
+};
+
+struct Add { static float apply(float a, float b) noexcept { return a + b; } };
+struct Sub { static float apply(float a, float b) noexcept { return a - b; } };
+struct Mul { static float apply(float a, float b) noexcept { return a * b; } };
+struct Div { static float apply(float a, float b) noexcept { return a / b; } };
+struct Min { static float apply(float a, float b) noexcept { return a < b ? a : b; } };
+struct Max { static float apply(float a, float b) noexcept { return a > b ? a : b; } };
+struct Neg { static float apply(float a) noexcept { return -a; } };
+struct Abs { static float apply(float a) noexcept { return std::fabs(a); } };
+struct Sqrt { static float apply(float a) noexcept { return std::sqrt(a); } };
+
+/// Anything usable as an operand: nodes, Signals, float spans, scalars.
+template <typename T>
+concept Operand = is_node<std::remove_cvref_t<T>>::value || std::is_same_v<std::remove_cvref_t<T>, Signal>
+    || std::is_convertible_v<T, std::span<const float>> || std::is_arithmetic_v<std::remove_cvref_t<T>>;
+
+/// At least one side must be a signal, so `2.0f * 3.0f` stays plain math.
+template <typename A, typename B>
+concept SignalOperands = Operand<A> && Operand<B>
+    && !(std::is_arithmetic_v<std::remove_cvref_t<A>> && std::is_arithmetic_v<std::remove_cvref_t<B>>);
+
+template <typename T>
+concept SignalOperand = Operand<T> && !std::is_arithmetic_v<std::remove_cvref_t<T>>;
+
+template <typename T>
+auto node(const T& t) noexcept;
+
+template <typename A, typename B, typename Op>
+using binary_t = Binary<Op, decltype(node(std::declval<const A&>())), decltype(node(std::declval<const B&>()))>;
+
+} // namespace expr
+
+/// An owning, 64-byte aligned mono signal that evaluates expressions.
+class Signal {
+public:
+    Signal() = default;
+    explicit Signal(std::size_t n) : buf_(n) {}
+
+    template <expr::SignalOperand E>
+        requires(!std::is_same_v<std::remove_cvref_t<E>, Signal>)
+    Signal(const E& e) : buf_(expr::extent(expr::node(e)))
+    {
+        assign(e);
+    }
+
+    template <expr::SignalOperand E>
+        requires(!std::is_same_v<std::remove_cvref_t<E>, Signal>)
+    Signal& operator=(const E& e)
+    {
+        const auto n = expr::node(e);
+        if (expr::extent(n) != buf_.size())
+            buf_ = AlignedBuffer<float>(expr::extent(n));
+        assign(e);
+        return *this;
+    }
+
+    template <expr::Operand E>
+    Signal& operator+=(const E& e) { return update<expr::Add>(e); }
+    template <expr::Operand E>
+    Signal& operator-=(const E& e) { return update<expr::Sub>(e); }
+    template <expr::Operand E>
+    Signal& operator*=(const E& e) { return update<expr::Mul>(e); }
+
+    std::size_t size() const noexcept { return buf_.size(); }
+    float* data() noexcept { return buf_.data(); }
+    const float* data() const noexcept { return buf_.data(); }
+    float& operator[](std::size_t i) noexcept { return buf_[i]; }
+    float operator[](std::size_t i) const noexcept { return buf_[i]; }
+    std::span<float> span() noexcept { return buf_.span(); }
+    std::span<const float> span() const noexcept { return {buf_.data(), buf_.size()}; }
+
+private:
+    template <typename E>
+    void assign(const E& e);
+
+    template <typename Op, typename E>
+    Signal& update(const E& e);
+
+    AlignedBuffer<float> buf_;
+};
+
+namespace expr {
+
+template <typename T>
+auto node(const T& t) noexcept
+{
+    using U = std::remove_cvref_t<T>;
+    if constexpr (is_node<U>::value)
+        return t;
+    else if constexpr (std::is_same_v<U, Signal>)
+        return Leaf{t.data(), t.size()};
+    else if constexpr (std::is_arithmetic_v<U>)
+        return Constant{static_cast<float>(t)};
+    else {
+        const std::span<const float> s = t;
+        return Leaf{s.data(), s.size()};
+    }
+}
+
+template <typename A, typename B>
+    requires SignalOperands<A, B>
+binary_t<A, B, Add> operator+(const A& a, const B& b) { return {node(a), node(b)}; }
+template <typename A, typename B>
+    requires SignalOperands<A, B>
+binary_t<A, B, Sub> operator-(const A& a, const B& b) { return {node(a), node(b)}; }
+template <typename A, typename B>
+    requires SignalOperands<A, B>
+binary_t<A, B, Mul> operator*(const A& a, const B& b) { return {node(a), node(b)}; }
+template <typename A, typename B>
+    requires SignalOperands<A, B>
+binary_t<A, B, Div> operator/(const A& a, const B& b) { return {node(a), node(b)}; }
+
+template <SignalOperand E>
+Unary<Neg, decltype(node(std::declval<const E&>()))> operator-(const E& e) { return {node(e)}; }
+
+} // namespace expr
+
+using expr::operator+;
+using expr::operator-;
+using expr::operator*;
+using expr::operator/;
+
+/// Sample-wise functions on expressions.
+template <expr::SignalOperand E>
+auto abs(const E& e) { return expr::Unary<expr::Abs, decltype(expr::node(e))>{expr::node(e)}; }
+template <expr::SignalOperand E>
+auto sqrt(const E& e) { return expr::Unary<expr::Sqrt, decltype(expr::node(e))>{expr::node(e)}; }
+template <typename A, typename B>
+    requires expr::SignalOperands<A, B>
+expr::binary_t<A, B, expr::Min> min(const A& a, const B& b) { return {expr::node(a), expr::node(b)}; }
+template <typename A, typename B>
+    requires expr::SignalOperands<A, B>
+expr::binary_t<A, B, expr::Max> max(const A& a, const B& b) { return {expr::node(a), expr::node(b)}; }
+
+/// Evaluate an expression into `out` in one pass. `out` may be one of the
+/// expression's own leaves: every sample is read before it is written.
+template <expr::SignalOperand E>
+void evaluate(std::span<float> out, const E& e)
+{
+    const auto n = expr::node(e);
+    if (expr::extent(n) != out.size())
+        throw std::length_error("evaluate: output length differs from expression");
+    float* o = out.data();
+    const std::size_t size = out.size();
+    for (std::size_t i = 0; i < size; ++i)
+        o[i] = n[i];
+}
+
+/// out += expression, in one pass.
+template <expr::SignalOperand E>
+void accumulate(std::span<float> out, const E& e)
+{
+    evaluate(out, out + e);
+}
+
+template <typename E>
+void Signal::assign(const E& e)
+{
+    evaluate(buf_.span(), e);
+}
+
+template <typename Op, typename E>
+Signal& Signal::update(const E& e)
+{
+    const expr::Binary<Op, expr::Leaf, decltype(expr::node(e))> x{expr::Leaf{data(), size()}, expr::node(e)};
+    evaluate(buf_.span(), x);
+    return *this;
+}
+
+} // namespace asg
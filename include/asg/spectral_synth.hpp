@@ -0,0 +1,141 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+#include <asg/fft.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace asg {
+
+/// Streaming frequency-domain synthesis by inverse FFT and overlap-add.
+///
+/// Each output frame of fft_size samples is produced from one spectrum of
+/// bins() = fft_size / 2 + 1 complex values supplied by the caller, windowed
+/// with a periodic Hann window and overlap-added at `hop` spacing. The
+/// overlap-added window sum is divided out per sample, so a stationary
+/// spectrum is reproduced at its nominal magnitude for any hop that keeps
+/// the window sum non-zero (hop <= fft_size / 2).
+///
+/// render() accepts any frame count; spectra are requested only when the
+/// overlap-add buffer runs dry. The plan, spectrum and accumulator are
+/// allocated once at construction.
+class SpectralSynth {
+public:
+    struct Config {
+        std::size_t fft_size = 1024;
+        std::size_t hop = 256;
+    };
+
+    explicit SpectralSynth(const Config& cfg)
+        : cfg_(cfg),
+          plan_(cfg.fft_size),
+          spectrum_(cfg.fft_size / 2 + 1),
+          frame_(cfg.fft_size),
+          window_(cfg.fft_size),
+          acc_(cfg.fft_size),
+          ready_(cfg.hop)
+    {
+        if (cfg.hop == 0 || cfg.hop > cfg.fft_size / 2)
+            throw std::invalid_argument("SpectralSynth: hop must be in (0, fft_size / 2]");
+        const double pi = 3.14159265358979323846;
+        const std::size_t n = cfg.fft_size;
+        for (std::size_t i = 0; i < n; ++i)
+            window_[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * pi * double(i) / double(n)));
+        // Fold the inverse overlap-added window sum into the window itself.
+        std::vector<float> norm(cfg.hop);
+        for (std::size_t i = 0; i < cfg.hop; ++i) {
+            double s = 0.0;
+            for (std::size_t j = i; j < n; j += cfg.hop)
+                s += window_[j];
+            norm[i] = static_cast<float>(1.0 / s);
+        }
+        for (std::size_t i = 0; i < n; ++i)
+            window_[i] *= norm[i % cfg.hop];
+    }
+
+    std::size_t fft_size() const noexcept { return cfg_.fft_size; }
+    std::size_t hop() const noexcept { return cfg_.hop; }
+    std::size_t bins() const noexcept { return spectrum_.size(); }
+
+    /// Index of the next spectrum frame that will be requested.
+    std::uint64_t frame_index() const noexcept { return frame_index_; }
+
+    /// Fill `out` with `frames` samples. `spectrum(index, bins)` is called
+    /// once per hop with a zeroed span of bins() values to fill; bin k is
+    /// at k * sample_rate / fft_size Hz and is scaled like FftPlan::forward()
+    /// output, i.e. a sinusoid of amplitude A has magnitude A * fft_size / 2.
+    /// The first fft_size - hop output samples fade in.
+    template <typename SpectrumFn>
+    void render(float* out, std::size_t frames, SpectrumFn&& spectrum)
+    {
+        while (frames > 0) {
+            if (ready_pos_ == cfg_.hop) {
+                std::fill(spectrum_.begin(), spectrum_.end(), cfloat{});
+                spectrum(frame_index_++, spectrum_.span());
+                synthesize();
+            }
+            const std::size_t n = std::min(frames, cfg_.hop - ready_pos_);
+            std::memcpy(out, ready_.data() + ready_pos_, n * sizeof(float));
+            ready_pos_ += n;
+            out += n;
+            frames -= n;
+        }
+    }
+
+    /// Render from a table of precomputed spectra, `bins()` values each,
+    /// looping over the table.
+    void render_table(float* out, std::size_t frames, std::span<const cfloat> table)
+    {
+        const std::size_t nb = bins();
+        const std::size_t count = table.size() / nb;
+        if (count == 0)
+            throw std::invalid_argument("SpectralSynth: empty spectrum table");
+        render(out, frames, [&](std::uint64_t index, std::span<cfloat> s) {
+            std::memcpy(s.data(), table.data() + (index % count) * nb, nb * sizeof(cfloat));
+        });
+    }
+
+    /// Drop buffered output and restart at frame 0.
+    void reset() noexcept
+    {
+        std::fill(acc_.begin(), acc_.end(), 0.0f);
+        ready_pos_ = cfg_.hop;
+        frame_index_ = 0;
+    }
+
+private:
+    void synthesize() noexcept
+    {
+        const std::size_t n = cfg_.fft_size;
+        const std::size_t hop = cfg_.hop;
+        plan_.inverse(spectrum_.data(), frame_.data());
+        float* acc = acc_.data();
+        const float* w = window_.data();
+        const float* f = frame_.data();
+        for (std::size_t i = 0; i < n; ++i)
+            acc[i] += w[i] * f[i];
+        std::memcpy(ready_.data(), acc, hop * sizeof(float));
+        std::memmove(acc, acc + hop, (n - hop) * sizeof(float));
+        std::fill(acc + n - hop, acc + n, 0.0f);
+        ready_pos_ = 0;
+    }
+
+    Config cfg_;
+    FftPlan plan_;
+    AlignedBuffer<cfloat> spectrum_;
+    AlignedBuffer<float> frame_;
+    AlignedBuffer<float> window_;
+    AlignedBuffer<float> acc_;
+    AlignedBuffer<float> ready_;
+    std::size_t ready_pos_ = cfg_.hop;
+    std::uint64_t frame_index_ = 0;
+};
+
+} // namespace asg
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+#include <asg/block_adapter.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace asg {
+
+/// What a splice segment plays: a pre-rendered buffer, referenced in
+/// place, or a live generator pulled sample-sequentially while active.
+class SpliceSource {
+public:
+    SpliceSource(std::span<const float> buffer) noexcept : data_(buffer.data()), size_(buffer.size()) {}
+
+    /// A live MonoSource; it must outlive the stream.
+    template <MonoSource S>
+    static SpliceSource live(S& source) noexcept
+    {
+        SpliceSource s({});
+        s.object_ = &source;
+        s.render_ = [](void* o, float* out, std::size_t n) { static_cast<S*>(o)->render(out, n); };
+        return s;
+    }
+
+    bool is_live() const noexcept { return render_ != nullptr; }
+    const float* data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+
+    /// Samples [offset, offset + n) of the segment; buffers are zero past
+    /// their end, live sources ignore `offset` and continue.
+    void read(std::uint64_t offset, float* out, std::size_t n) const noexcept
+    {
+        if (render_) {
+            render_(object_, out, n);
+            return;
+        }
+        const std::size_t avail = offset < size_ ? std::min<std::size_t>(n, size_ - offset) : 0;
+        std::copy(data_ + offset, data_ + offset + avail, out);
+        std::fill(out + avail, out + n, 0.0f);
+    }
+
+private:
+    const float* data_ = nullptr;
+    std::size_t size_ = 0;
+    void* object_ = nullptr;
+    void (*render_)(void*, float*, std::size_t) = nullptr;
+};
+
+enum class FadeShape { equal_power, linear, custom };
+
+/// Transition into a segment. The outgoing segment fades with the
+/// time-reversed curve, which is complementary for equal-power (sin/cos)
+/// and linear fades and for any custom curve with the same symmetry.
+struct Crossfade {
+    std::size_t length = 0; ///< samples; 0 = butt splice
+    FadeShape shape = FadeShape::equal_power;
+    std::vector<float> curve; ///< custom fade-in gains, `length` samples
+};
+
+/// Gapless, sample-accurate concatenation of stimuli.
+///
+/// Each segment starts at an absolute sample position; its crossfade runs
+/// from that position for the fade length, during which the previous
+/// segment fades out, and the previous segment stops when the fade ends.
+/// Segments whose source ends early leave silence; starts after the
+/// previous segment's end leave a gap.
+///
+/// Sources are never copied into an intermediate stream: render() reads
+/// each buffer at its offset straight into the caller's block, and
+/// view() hands out spans of the source buffer itself wherever a single
+/// buffer segment plays without a fade, so a writer or device with its
+/// own buffers can take them without any copy at all. Fade tables are
+/// built by append(); render() and view() do not allocate.
+class SpliceStream {
+public:
+    explicit SpliceStream(std::size_t max_block = 4096) : scratch_a_(max_block), scratch_b_(max_block), max_block_(max_block)
+    {
+        if (max_block == 0)
+            throw std::invalid_argument("SpliceStream: max_block must be positive");
+    }
+
+    std::uint64_t position() const noexcept { return pos_; }
+
+    /// Add a segment starting at `start`. Segments must be appended in
+    /// order, and a start may not fall inside the previous segment's fade.
+    void append(SpliceSource source, std::uint64_t start, const Crossfade& fade = {})
+    {
+        if (!segments_.empty()) {
+            const Segment& last = segments_.back();
+            if (start < last.start + last.fade.size())
+                throw std::invalid_argument("SpliceStream: segment starts inside the previous crossfade");
+        }
+        if (start < pos_)
+            throw std::invalid_argument("SpliceStream: segment starts in the past");
+        Segment seg{source, start, AlignedBuffer<float>(fade.length)};
+        for (std::size_t i = 0; i < fade.length; ++i) {
+            const double t = (double(i) + 0.5) / double(fade.length);
+            switch (fade.shape) {
+            case FadeShape::equal_power: seg.fade[i] = static_cast<float>(std::sin(1.57079632679489662 * t)); break;
+            case FadeShape::linear: seg.fade[i] = static_cast<float>(t); break;
+            case FadeShape::custom:
+                if (fade.curve.size() != fade.length)
+                    throw std::invalid_argument("SpliceStream: custom curve length differs from fade length");
+                seg.fade[i] = fade.curve[i];
+                break;
+            }
+        }
+        segments_.push_back(std::move(seg));
+    }
+
+    /// Drop all segments and restart at `position`.
+    void clear(std::uint64_t position = 0) noexcept
+    {
+        segments_.clear();
+        cur_ = 0;
+        pos_ = position;
+    }
+
+    /// Write the next `frames` samples.
+    void render(float* out, std::size_t frames) noexcept
+    {
+        while (frames > 0) {
+            advance();
+            const std::size_t n = std::min({frames, max_block_, piece()});
+            const Segment* seg = current();
+            if (!seg) {
+                std::fill(out, out + n, 0.0f);
+            } else if (in_fade()) {
+                const Segment& prev = segments_[cur_ - 1];
+                const std::size_t k = static_cast<std::size_t>(pos_ - seg->start);
+                const std::size_t L = seg->fade.size();
+                prev.source.read(pos_ - prev.start, scratch_a_.data(), n);
+                seg->source.read(k, scratch_b_.data(), n);
+                const float* __restrict a = scratch_a_.data();
+                const float* __restrict b = scratch_b_.data();
+                const float* __restrict g = seg->fade.data();
+                for (std::size_t i = 0; i < n; ++i)
+                    out[i] = g[L - 1 - (k + i)] * a[i] + g[k + i] * b[i];
+            } else {
+                seg->source.read(pos_ - seg->start, out, n);
+            }
+            out += n;
+            frames -= n;
+            pos_ += n;
+        }
+    }
+
+    /// Zero-copy read: up to `max` samples taken directly from the current
+    /// buffer segment, or an empty span where render() is needed (fades,
+    /// live sources, gaps, past a buffer's end).
+    std::span<const float> view(std::size_t max) noexcept
+    {
+        advance();
+        const Segment* seg = current();
+        if (!seg || seg->source.is_live() || in_fade())
+            return {};
+        const std::uint64_t off = pos_ - seg->start;
+        if (off >= seg->source.size())
+            return {};
+        const std::size_t n = std::min({max, piece(), static_cast<std::size_t>(seg->source.size() - off)});
+        pos_ += n;
+        return {seg->source.data() + off, n};
+    }
+
+private:
+    struct Segment {
+        SpliceSource source;
+        std::uint64_t start;
+        AlignedBuffer<float> fade;
+    };
+
+    /// Make cur_ the last segment that has started.
+    void advance() noexcept
+    {
+        while (cur_ + 1 < segments_.size() && segments_[cur_ + 1].start <= pos_)
+            ++cur_;
+    }
+
+    const Segment* current() const noexcept
+    {
+        return cur_ < segments_.size() && segments_[cur_].start <= pos_ ? &segments_[cur_] : nullptr;
+    }
+
+    bool in_fade() const noexcept
+    {
+        const Segment* seg = current();
+        return seg && cur_ > 0 && pos_ < seg->start + seg->fade.size();
+    }
+
+    /// Samples until the next boundary: a segment start or a fade end.
+    std::size_t piece() const noexcept
+    {
+        std::uint64_t next = ~std::uint64_t(0);
+        const Segment* seg = current();
+        if (seg && pos_ < seg->start + seg->fade.size())
+            next = seg->start + seg->fade.size();
+        const std::size_t i = seg ? cur_ + 1 : cur_;
+        if (i < segments_.size())
+            next = std::min(next, segments_[i].start);
+        return static_cast<std::size_t>(std::min<std::uint64_t>(next - pos_, ~std::size_t(0)));
+    }
+
+    std::vector<Segment> segments_;
+    std::size_t cur_ = 0;
+    std::uint64_t pos_ = 0;
+    AlignedBuffer<float> scratch_a_, scratch_b_;
+    std::size_t max_block_;
+};
+
+} // namespace asg
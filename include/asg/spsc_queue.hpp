@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace asg {
+
+/// Fixed rather than std::hardware_destructive_interference_size, whose
+/// value may differ between translation units built with different flags.
+inline constexpr std::size_t cache_line = 64;
+
+/// Bounded wait-free single-producer/single-consumer ring.
+///
+/// Used to hand data across the real-time boundary: neither side ever
+/// blocks or allocates after construction. Capacity is rounded up to a
+/// power of two.
+template <typename T>
+class SpscQueue {
+    static_assert(std::is_nothrow_move_constructible_v<T>);
+    static_assert(std::is_nothrow_destructible_v<T>);
+
+public:
+    explicit SpscQueue(std::size_t capacity)
+    {
+        if (capacity == 0)
+            throw std::invalid_argument("SpscQueue: capacity must be > 0");
+        std::size_t n = 1;
+        while (n < capacity)
+            n <<= 1;
+        mask_ = n - 1;
+        slots_ = std::allocator<Slot>{}.allocate(n);
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    ~SpscQueue()
+    {
+        while (try_pop()) {
+        }
+        std::allocator<Slot>{}.deallocate(slots_, mask_ + 1);
+    }
+
+    std::size_t capacity() const noexcept { return mask_ + 1; }
+
+    /// Producer side. Returns false when the queue is full.
+    template <typename... Args>
+    bool try_emplace(Args&&... args) noexcept(std::is_nothrow_constructible_v<T, Args...>)
+    {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_cache_ > mask_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head - tail_cache_ > mask_)
+                return false;
+        }
+        ::new (slots_[head & mask_].storage) T(std::forward<Args>(args)...);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(T value) noexcept { return try_emplace(std::move(value)); }
+
+    /// Consumer side. Returns a pointer to the oldest element or nullptr.
+    /// The element stays valid until pop().
+    T* front() noexcept
+    {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_cache_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail == head_cache_)
+                return nullptr;
+        }
+        return std::launder(reinterpret_cast<T*>(slots_[tail & mask_].storage));
+    }
+
+    /// Consumer side. Only valid after front() returned non-null.
+    void pop() noexcept
+    {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        std::launder(reinterpret_cast<T*>(slots_[tail & mask_].storage))->~T();
+        tail_.store(tail + 1, std::memory_order_release);
+    }
+
+    std::optional<T> try_pop() noexcept
+    {
+        T* p = front();
+        if (!p)
+            return std::nullopt;
+        std::optional<T> out(std::move(*p));
+        pop();
+        return out;
+    }
+
+    /// Approximate number of queued elements; exact only when both sides
+    /// are quiescent.
+    std::size_t size_approx() const noexcept
+    {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    Slot* slots_ = nullptr;
+    std::size_t mask_ = 0;
+
+    alignas(cache_line) std::atomic<std::size_t> head_{0};
+    std::size_t tail_cache_ = 0;
+    alignas(cache_line) std::atomic<std::size_t> tail_{0};
+    std::size_t head_cache_ = 0;
+};
+
+} // namespace asg
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+#include <asg/lossless_codec.hpp>
+#include <asg/mapped_file.hpp>
+#include <asg/thread_pool.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace asg {
+
+/// A precomputed float table: lookup tables, filter kernels, noise tokens.
+/// `version` must be bumped whenever the builder's output changes, which
+/// invalidates any persisted copy. Large stimuli may set `compress` to be
+/// stored with the lossless codec; they are then decoded (in parallel
+/// chunks) on load instead of being served from the mapping.
+struct TableSpec {
+    std::string name;
+    std::uint32_t version = 1;
+    std::size_t size = 0;
+    std::function<void(std::span<float>)> build;
+    bool compress = false;
+};
+
+/// On-disk layout of the table cache.
+///
+/// Header, then a directory of fixed-size entries, then table payloads,
+/// each aligned to 64 bytes so mapped tables are SIMD-aligned. The header
+/// carries a key hashed over every (name, version, size, compress) and the
+/// format version; any mismatch means the cache is stale and is rebuilt.
+/// Compressed payloads are lossless_codec blobs of `stored_bytes` bytes.
+namespace table_cache_format {
+
+inline constexpr char magic[8] = {'A', 'S', 'G', 'T', 'A', 'B', 'L', '1'};
+inline constexpr std::uint32_t version = 2;
+inline constexpr std::uint32_t flag_compressed = 1;
+inline constexpr std::size_t name_bytes = 48;
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t entry_count;
+    std::uint64_t key;
+    std::uint64_t file_size;
+};
+
+struct Entry {
+    char name[name_bytes];
+    std::uint32_t version;
+    std::uint32_t flags;
+    std::uint64_t offset;
+    std::uint64_t size; // in floats
+    std::uint64_t stored_bytes;
+};
+
+inline std::uint64_t fnv1a(const void* data, std::size_t n, std::uint64_t h = 0xCBF29CE484222325ull)
+{
+    const auto* p = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < n; ++i)
+        h = (h ^ p[i]) * 0x100000001B3ull;
+    return h;
+}
+
+inline std::size_t align64(std::size_t n) { return (n + 63) & ~std::size_t(63); }
+
+} // namespace table_cache_format
+
+/// Registry of precomputed tables with a parallel warm-up stage and an
+/// optional persistent cache.
+///
+/// warm_up() first tries to map the cache file; if it is present and its
+/// key matches the registered specs, every uncompressed table is served
+/// straight from the mapping and startup costs one mmap plus decoding of
+/// any compressed entries. Otherwise all tables are built
+/// concurrently on the pool and, if a path was given, written to a
+/// temporary file that is atomically renamed into place.
+///
+/// Table spans stay valid for the lifetime of the TableCache.
+class TableCache {
+public:
+    /// Register a table; returns its index for table(). Must precede warm_up().
+    std::size_t add(TableSpec spec)
+    {
+        if (ready_)
+            throw std::logic_error("TableCache: add() after warm_up()");
+        if (spec.name.size() >= table_cache_format::name_bytes)
+            throw std::invalid_argument("TableCache: table name too long: " + spec.name);
+        for (const auto& s : specs_)
+            if (s.name == spec.name)
+                throw std::invalid_argument("TableCache: duplicate table: " + spec.name);
+        specs_.push_back(std::move(spec));
+        return specs_.size() - 1;
+    }
+
+    /// Returns true when tables were loaded from the cache file.
+    bool warm_up(ThreadPool& pool, const std::string& cache_path = {})
+    {
+        if (ready_)
+            throw std::logic_error("TableCache: warm_up() called twice");
+        tables_.assign(specs_.size(), {});
+        built_.resize(specs_.size());
+        bool hit = !cache_path.empty() && try_map(cache_path, pool);
+        if (!hit) {
+            pool.parallel_for(specs_.size(), [this](std::size_t i) {
+                built_[i] = AlignedBuffer<float>(specs_[i].size);
+                specs_[i].build(built_[i].span());
+            });
+            for (std::size_t i = 0; i < specs_.size(); ++i)
+                tables_[i] = built_[i].span();
+            if (!cache_path.empty()) {
+                // An unwritable cache only costs the next launch a rebuild.
+                try {
+                    persist(cache_path, pool);
+                } catch (const std::system_error&) {
+                }
+            }
+        }
+        ready_ = true;
+        return hit;
+    }
+
+    bool ready() const noexcept { return ready_; }
+    std::size_t size() const noexcept { return specs_.size(); }
+
+    std::span<const float> table(std::size_t index) const noexcept { return tables_[index]; }
+
+    std::span<const float> table(std::string_view name) const
+    {
+        for (std::size_t i = 0; i < specs_.size(); ++i)
+            if (specs_[i].name == name)
+                return tables_[i];
+        throw std::out_of_range("TableCache: no table named " + std::string(name));
+    }
+
+private:
+    std::uint64_t key() const noexcept
+    {
+        using namespace table_cache_format;
+        std::uint64_t h = fnv1a(&version, sizeof version);
+        for (const auto& s : specs_) {
+            h = fnv1a(s.name.data(), s.name.size() + 1, h);
+            h = fnv1a(&s.version, sizeof s.version, h);
+            const std::uint64_t n = s.size;
+            h = fnv1a(&n, sizeof n, h);
+            h = fnv1a(&s.compress, sizeof s.compress, h);
+        }
+        return h;
+    }
+
+    bool try_map(const std::string& path, ThreadPool& pool)
+    {
+        using namespace table_cache_format;
+        MappedFile file;
+        try {
+            file = MappedFile(path);
+        } catch (const std::system_error&) {
+            return false;
+        }
+        Header h{};
+        if (file.size() < sizeof h)
+            return false;
+        std::memcpy(&h, file.data(), sizeof h);
+        if (std::memcmp(h.magic, magic, sizeof magic) != 0 || h.version != version || h.key != key()
+            || h.entry_count != specs_.size() || h.file_size != file.size()
+            || sizeof h + specs_.size() * sizeof(Entry) > file.size())
+            return false;
+        const auto* entries = reinterpret_cast<const Entry*>(file.data() + sizeof h);
+        for (std::size_t i = 0; i < specs_.size(); ++i) {
+            const Entry& e = entries[i];
+            const bool compressed = e.flags & flag_compressed;
+            if (specs_[i].name != std::string_view(e.name, ::strnlen(e.name, name_bytes))
+                || e.version != specs_[i].version || e.size != specs_[i].size || compressed != specs_[i].compress
+                || e.offset > file.size() || e.stored_bytes > file.size() - e.offset)
+                return false;
+            // Uncompressed tables are used in place as float arrays.
+            if (!compressed
+                && (e.stored_bytes != e.size * sizeof(float) || e.offset % alignof(float) != 0))
+                return false;
+        }
+        file.advise(MADV_WILLNEED);
+        try {
+            for (std::size_t i = 0; i < specs_.size(); ++i) {
+                const Entry& e = entries[i];
+                if (e.flags & flag_compressed) {
+                    built_[i] = AlignedBuffer<float>(e.size);
+                    lossless_codec::decode({reinterpret_cast<const std::uint8_t*>(file.data() + e.offset), e.stored_bytes},
+                                           built_[i].span(), &pool);
+                    tables_[i] = built_[i].span();
+                } else {
+                    tables_[i] = {reinterpret_cast<const float*>(file.data() + e.offset), e.size};
+                }
+            }
+        } catch (const std::exception&) {
+            // Corrupt payload: fall back to rebuilding everything.
+            for (auto& b : built_)
+                b = {};
+            return false;
+        }
+        mapping_ = std::move(file);
+        return true;
+    }
+
+    void persist(const std::string& path, ThreadPool& pool) const
+    {
+        using namespace table_cache_format;
+        std::vector<std::vector<std::uint8_t>> blobs(specs_.size());
+        for (std::size_t i = 0; i < specs_.size(); ++i)
+            if (specs_[i].compress)
+                blobs[i] = lossless_codec::encode(built_[i].span(), &pool);
+
+        std::vector<Entry> entries(specs_.size());
+        std::size_t offset = align64(sizeof(Header) + entries.size() * sizeof(Entry));
+        for (std::size_t i = 0; i < specs_.size(); ++i) {
+            Entry& e = entries[i];
+            std::memset(&e, 0, sizeof e);
+            std::memcpy(e.name, specs_[i].name.c_str(), specs_[i].name.size() + 1);
+            e.version = specs_[i].version;
+            e.offset = offset;
+            e.size = specs_[i].size;
+            e.flags = specs_[i].compress ? flag_compressed : 0;
+            e.stored_bytes = specs_[i].compress ? blobs[i].size() : e.size * sizeof(float);
+            offset = align64(offset + e.stored_bytes);
+        }
+        Header h{};
+        std::memcpy(h.magic, magic, sizeof magic);
+        h.version = version;
+        h.entry_count = static_cast<std::uint32_t>(entries.size());
+        h.key = key();
+        h.file_size = offset;
+
+        const std::string tmp = path + ".tmp";
+        {
+            FileDescriptor fd = FileDescriptor::open(tmp, O_RDWR | O_CREAT | O_TRUNC);
+            fd.truncate(offset);
+            if (offset > 0) {
+                MappedRegion out(fd, 0, offset, true);
+                std::memcpy(out.data(), &h, sizeof h);
+                std::memcpy(out.data() + sizeof h, entries.data(), entries.size() * sizeof(Entry));
+                for (std::size_t i = 0; i < specs_.size(); ++i) {
+                    const void* src = specs_[i].compress ? static_cast<const void*>(blobs[i].data()) : built_[i].data();
+                    std::memcpy(out.data() + entries[i].offset, src, entries[i].stored_bytes);
+                }
+                out.sync();
+            }
+        }
+        if (std::rename(tmp.c_str(), path.c_str()) != 0)
+            throw sys_error("rename " + tmp);
+    }
+
+    std::vector<TableSpec> specs_;
+    std::vector<std::span<const float>> tables_;
+    std::vector<AlignedBuffer<float>> built_;
+    MappedFile mapping_;
+    bool ready_ = false;
+};
+
+} // namespace asg
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace asg {
+
+/// Fixed-size worker pool for offline work (table builds, batch renders).
+/// Not for use from the real-time thread.
+class ThreadPool {
+public:
+    explicit ThreadPool(std::size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        workers_.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i)
+            workers_.emplace_back([this] { run(); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& t : workers_)
+            t.join();
+    }
+
+    std::size_t size() const noexcept { return workers_.size(); }
+
+    template <typename F>
+    auto submit(F&& f) -> std::future<std::invoke_result_t<F>>
+    {
+        using R = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        auto fut = task->get_future();
+        {
+            std::lock_guard lock(mutex_);
+            tasks_.emplace_back([task] { (*task)(); });
+        }
+        cv_.notify_one();
+        return fut;
+    }
+
+    /// Run fn(i) for i in [0, n) across the pool and the calling thread.
+    /// Indices are handed out dynamically, so uneven items balance. The
+    /// first exception thrown by fn is rethrown after all items finish.
+    template <typename F>
+    void parallel_for(std::size_t n, F&& fn)
+    {
+        if (n == 0)
+            return;
+        std::atomic<std::size_t> next{0};
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        auto body = [&] {
+            for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < n;) {
+                try {
+                    fn(i);
+                } catch (...) {
+                    std::lock_guard lock(error_mutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+            }
+        };
+        const std::size_t helpers = std::min(workers_.size(), n - 1);
+        std::vector<std::future<void>> futures;
+        futures.reserve(helpers);
+        for (std::size_t h = 0; h < helpers; ++h)
+            futures.push_back(submit(body));
+        body();
+        for (auto& f : futures)
+            f.get();
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+private:
+    void run()
+    {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(mutex_);
+                cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+                if (stop_ && tasks_.empty())
+                    return;
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+};
+
+} // namespace asg
@@ -0,0 +1,303 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+#include <asg/fft.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace asg {
+
+namespace time_scale_detail {
+
+inline constexpr double pi = 3.14159265358979323846;
+
+/// Periodic Hann window; sums to 1 at 50% overlap and to 1.5 at 75%.
+inline void hann(AlignedBuffer<float>& w)
+{
+    const std::size_t n = w.size();
+    for (std::size_t i = 0; i < n; ++i)
+        w[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * pi * double(i) / double(n)));
+}
+
+/// Copy in[start, start + n) to out, zero outside the input.
+inline void read_padded(std::span<const float> in, std::int64_t start, float* out, std::size_t n) noexcept
+{
+    const auto size = static_cast<std::int64_t>(in.size());
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::int64_t t = start + static_cast<std::int64_t>(i);
+        out[i] = t >= 0 && t < size ? in[static_cast<std::size_t>(t)] : 0.0f;
+    }
+}
+
+inline std::size_t next_pow2(std::size_t n) noexcept
+{
+    std::size_t p = 4;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
+} // namespace time_scale_detail
+
+/// Waveform-similarity overlap-add time stretcher for speech tokens.
+///
+/// Output frames of `frame` samples are overlap-added at half-frame hops
+/// with a Hann window. Each frame is read from the input near its nominal
+/// position (output position * rate), displaced by up to ±`search` samples
+/// to the offset whose cross-correlation with the natural continuation of
+/// the previous frame is highest, so pitch periods line up and no phasing
+/// is introduced. The whole search range is scored at once by one FFT
+/// cross-correlation instead of 2 * search dot products.
+///
+/// All buffers and FFT plans are allocated by the constructor, so
+/// stretch() does not allocate and one instance can process every token
+/// of a session.
+class Wsola {
+public:
+    struct Config {
+        std::size_t frame = 1024; ///< even; ~20-40 ms of speech
+        std::size_t search = 256; ///< maximum displacement in samples
+    };
+
+    Wsola() : Wsola(Config{}) {}
+
+    explicit Wsola(const Config& cfg)
+        : cfg_(cfg),
+          hop_(cfg.frame / 2),
+          plan_(time_scale_detail::next_pow2(cfg.frame + 2 * cfg.search)),
+          window_(cfg.frame),
+          frame_(cfg.frame),
+          region_(plan_.size()),
+          corr_(plan_.size()),
+          tspec_(plan_.bins()),
+          rspec_(plan_.bins())
+    {
+        if (cfg.frame < 16 || cfg.frame % 2 != 0)
+            throw std::invalid_argument("Wsola: frame must be even and at least 16");
+        time_scale_detail::hann(window_);
+    }
+
+    /// Output length for an input of `frames` at playback `rate`
+    /// (rate > 1 is faster, i.e. shorter).
+    static std::size_t output_size(std::size_t frames, double rate) noexcept
+    {
+        return static_cast<std::size_t>(std::floor(static_cast<double>(frames) / rate));
+    }
+
+    /// Stretch `in` by 1/rate into `out`; returns the frames written
+    /// (output_size(), or less if `out` is shorter).
+    std::size_t stretch(std::span<const float> in, double rate, std::span<float> out)
+    {
+        if (!(rate > 0.0))
+            throw std::invalid_argument("Wsola: rate must be positive");
+        const std::size_t total = std::min(out.size(), output_size(in.size(), rate));
+        std::fill(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(total), 0.0f);
+
+        const auto L = static_cast<std::int64_t>(cfg_.frame);
+        const auto H = static_cast<std::int64_t>(hop_);
+        const auto S = static_cast<std::int64_t>(cfg_.search);
+        std::int64_t prev = 0;
+        for (std::int64_t k = 0; (k - 1) * H < static_cast<std::int64_t>(total); ++k) {
+            // First frame starts half a frame early so the output's first
+            // half frame gets full window coverage.
+            const std::int64_t out_pos = k * H - H;
+            std::int64_t pos = static_cast<std::int64_t>(std::llround(static_cast<double>(out_pos) * rate));
+            if (k > 0)
+                pos = best_match(in, prev + H, pos - S);
+            prev = pos;
+
+            time_scale_detail::read_padded(in, pos, frame_.data(), cfg_.frame);
+            for (std::int64_t i = 0; i < L; ++i) {
+                const std::int64_t t = out_pos + i;
+                if (t >= 0 && t < static_cast<std::int64_t>(total))
+                    out[static_cast<std::size_t>(t)] += window_[static_cast<std::size_t>(i)] * frame_[static_cast<std::size_t>(i)];
+            }
+        }
+        return total;
+    }
+
+private:
+    /// Start of the frame in [lo, lo + 2 * search] that correlates best
+    /// with the template starting at `natural`.
+    std::int64_t best_match(std::span<const float> in, std::int64_t natural, std::int64_t lo) noexcept
+    {
+        const std::size_t n = plan_.size();
+        std::fill(region_.begin(), region_.end(), 0.0f);
+        time_scale_detail::read_padded(in, natural, region_.data(), cfg_.frame);
+        plan_.forward(region_.data(), tspec_.data());
+
+        time_scale_detail::read_padded(in, lo, region_.data(), std::min(n, cfg_.frame + 2 * cfg_.search));
+        plan_.forward(region_.data(), rspec_.data());
+
+        for (std::size_t b = 0; b < plan_.bins(); ++b)
+            rspec_[b] *= std::conj(tspec_[b]);
+        plan_.inverse(rspec_.data(), corr_.data());
+
+        std::size_t best = 0;
+        for (std::size_t j = 1; j <= 2 * cfg_.search; ++j)
+            if (corr_[j] > corr_[best])
+                best = j;
+        return lo + static_cast<std::int64_t>(best);
+    }
+
+    Config cfg_;
+    std::size_t hop_;
+    FftPlan plan_;
+    AlignedBuffer<float> window_, frame_, region_, corr_;
+    AlignedBuffer<cfloat> tspec_, rspec_;
+};
+
+/// Phase-vocoder pitch shifter.
+///
+/// The token is time-stretched by the pitch ratio with a phase vocoder
+/// (analysis hop = synthesis hop / ratio, per-bin instantaneous frequency
+/// from the phase advance) and then resampled back to its original length
+/// with cubic interpolation, which scales every frequency by the ratio
+/// while keeping the duration. Formants move with the pitch, as in any
+/// plain vocoder shift.
+///
+/// Upward shifts decimate the stretched signal, so the vocoder drops every
+/// bin whose instantaneous frequency times the ratio would reach Nyquist;
+/// nothing folds back except Hann sidelobe leakage (about -31 dB) from
+/// components just above the limit. Downward shifts interpolate, and the
+/// Catmull-Rom kernel leaves faint images of content near Nyquist.
+///
+/// Spectra, phases and the stretched intermediate are members reused
+/// across calls; the intermediate only grows when a longer token arrives.
+class PitchShifter {
+public:
+    struct Config {
+        std::size_t fft_size = 2048; ///< power of two
+        std::size_t overlap = 4;     ///< frames per FFT length: hop = fft_size / overlap
+    };
+
+    PitchShifter() : PitchShifter(Config{}) {}
+
+    explicit PitchShifter(const Config& cfg)
+        : cfg_(cfg),
+          hop_(cfg.fft_size / std::max<std::size_t>(cfg.overlap, 1)),
+          plan_(cfg.fft_size),
+          window_(cfg.fft_size),
+          frame_(cfg.fft_size),
+          spec_(plan_.bins()),
+          last_phase_(plan_.bins()),
+          sum_phase_(plan_.bins())
+    {
+        if (cfg.overlap < 4 || cfg.fft_size % cfg.overlap != 0)
+            throw std::invalid_argument("PitchShifter: overlap must be >= 4 and divide fft_size");
+        time_scale_detail::hann(window_);
+        // Frames are windowed twice (analysis and synthesis); for Hann at
+        // overlap >= 4 the overlapped sum of w^2 is constant.
+        double norm = 0.0;
+        for (std::size_t i = 0; i < cfg.fft_size; i += hop_)
+            norm += double(window_[i]) * window_[i];
+        ola_gain_ = static_cast<float>(1.0 / norm);
+    }
+
+    static double semitones(double st) noexcept { return std::exp2(st / 12.0); }
+
+    /// Shift `in` by `ratio` (2 = up an octave) into `out`, which must be
+    /// as long as `in`.
+    void shift(std::span<const float> in, double ratio, std::span<float> out)
+    {
+        if (!(ratio > 0.0))
+            throw std::invalid_argument("PitchShifter: ratio must be positive");
+        if (out.size() < in.size())
+            throw std::invalid_argument("PitchShifter: output shorter than input");
+        if (in.empty())
+            return;
+        const std::size_t stretched = static_cast<std::size_t>(std::ceil(static_cast<double>(in.size()) * ratio)) + 4;
+        vocode(in, ratio, stretched);
+        resample(ratio, out.first(in.size()));
+    }
+
+private:
+    void vocode(std::span<const float> in, double ratio, std::size_t length)
+    {
+        using time_scale_detail::pi;
+        const std::size_t n = cfg_.fft_size;
+        const std::size_t bins = plan_.bins();
+        if (stretch_.size() < length + n)
+            stretch_.resize(length + n);
+        std::fill(stretch_.begin(), stretch_.begin() + static_cast<std::ptrdiff_t>(length + n), 0.0f);
+        std::fill(last_phase_.begin(), last_phase_.end(), 0.0f);
+        std::fill(sum_phase_.begin(), sum_phase_.end(), 0.0f);
+
+        // Synthesis frame k sits at k * hop - n / 2 (centred on k * hop);
+        // its analysis frame is centred on k * hop / ratio.
+        const auto half = static_cast<std::int64_t>(n / 2);
+        std::int64_t prev_a = 0;
+        for (std::size_t k = 0; k * hop_ < length; ++k) {
+            const std::int64_t a = std::llround(static_cast<double>(k * hop_) / ratio) - half;
+            time_scale_detail::read_padded(in, a, frame_.data(), n);
+            for (std::size_t i = 0; i < n; ++i)
+                frame_[i] *= window_[i];
+            plan_.forward(frame_.data(), spec_.data());
+
+            const double ha = static_cast<double>(a - prev_a);
+            for (std::size_t b = 0; b < bins; ++b) {
+                const float mag = std::abs(spec_[b]);
+                const float phase = std::arg(spec_[b]);
+                const double omega = 2.0 * pi * double(b) / double(n);
+                double inst = omega;
+                if (k == 0) {
+                    sum_phase_[b] = phase;
+                } else {
+                    double dev = double(phase) - last_phase_[b] - omega * ha;
+                    dev -= 2.0 * pi * std::round(dev / (2.0 * pi));
+                    if (ha > 0.0)
+                        inst += dev / ha;
+                    sum_phase_[b] = static_cast<float>(std::remainder(double(sum_phase_[b]) + inst * double(hop_), 2.0 * pi));
+                }
+                last_phase_[b] = phase;
+                // resample() scales every frequency by the ratio; drop what
+                // would land at or above Nyquist instead of letting it fold.
+                spec_[b] = std::fabs(inst) * ratio < pi ? std::polar(mag, sum_phase_[b]) : cfloat{};
+            }
+            prev_a = a;
+
+            plan_.inverse(spec_.data(), frame_.data());
+            const std::int64_t s = static_cast<std::int64_t>(k * hop_) - half;
+            for (std::size_t i = 0; i < n; ++i) {
+                const std::int64_t t = s + static_cast<std::int64_t>(i);
+                if (t >= 0)
+                    stretch_[static_cast<std::size_t>(t)] += ola_gain_ * window_[i] * frame_[i];
+            }
+        }
+        length_ = length;
+    }
+
+    /// out[i] = stretched(i * ratio), Catmull-Rom interpolated.
+    void resample(double ratio, std::span<float> out) const noexcept
+    {
+        const float* y = stretch_.data();
+        const auto at = [&](std::int64_t i) {
+            return i >= 0 && static_cast<std::size_t>(i) < length_ ? y[i] : 0.0f;
+        };
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            const double x = static_cast<double>(i) * ratio;
+            const auto j = static_cast<std::int64_t>(x);
+            const auto f = static_cast<float>(x - static_cast<double>(j));
+            const float p0 = at(j - 1), p1 = at(j), p2 = at(j + 1), p3 = at(j + 2);
+            out[i] = p1 + 0.5f * f * (p2 - p0 + f * (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3 + f * (3.0f * (p1 - p2) + p3 - p0)));
+        }
+    }
+
+    Config cfg_;
+    std::size_t hop_;
+    FftPlan plan_;
+    AlignedBuffer<float> window_, frame_;
+    AlignedBuffer<cfloat> spec_;
+    AlignedBuffer<float> last_phase_, sum_phase_;
+    std::vector<float> stretch_;
+    std::size_t length_ = 0;
+    float ola_gain_ = 1.0f;
+};
+
+} // namespace asg
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+#include <asg/procedural.hpp>
+#include <asg/thread_pool.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace asg {
+
+/// An asynchronous render of many procedural tokens on a ThreadPool.
+///
+/// submit() queues one pool task per token and returns at once; the
+/// caller polls done() or blocks in wait(). Outputs either live in one
+/// 64-byte aligned buffer owned by the batch (job i at job(i)) or are
+/// caller-owned spans that the batch writes in place, so a host runtime
+/// can hand over its own arrays and receive the samples with no copy.
+/// Caller-owned outputs and the registry must stay valid until done()
+/// (destroying the pool also waits for it). The batch is shared with its
+/// tasks and stays alive until the last one finishes, even if the caller
+/// drops it first.
+class TokenBatch : public std::enable_shared_from_this<TokenBatch> {
+public:
+    /// Render each token into a buffer owned by the batch.
+    static std::shared_ptr<TokenBatch> submit(ThreadPool& pool, const ProceduralRegistry& registry,
+                                              std::vector<ProceduralToken> tokens)
+    {
+        std::shared_ptr<TokenBatch> b(new TokenBatch(std::move(tokens)));
+        std::size_t total = 0;
+        for (const ProceduralToken& t : b->tokens_)
+            total += (static_cast<std::size_t>(t.length) + 15) & ~std::size_t(15);
+        b->storage_ = AlignedBuffer<float>(total);
+        std::size_t offset = 0;
+        for (const ProceduralToken& t : b->tokens_) {
+            b->outputs_.emplace_back(b->storage_.data() + offset, static_cast<std::size_t>(t.length));
+            offset += (static_cast<std::size_t>(t.length) + 15) & ~std::size_t(15);
+        }
+        b->launch(pool, registry);
+        return b;
+    }
+
+    /// Render token i into outputs[i]: outputs[i].size() samples, zero
+    /// past the token's end.
+    static std::shared_ptr<TokenBatch> submit(ThreadPool& pool, const ProceduralRegistry& registry,
+                                              std::vector<ProceduralToken> tokens, std::vector<std::span<float>> outputs)
+    {
+        if (outputs.size() != tokens.size())
+            throw std::invalid_argument("TokenBatch: one output per token");
+        std::shared_ptr<TokenBatch> b(new TokenBatch(std::move(tokens)));
+        b->outputs_ = std::move(outputs);
+        b->launch(pool, registry);
+        return b;
+    }
+
+    TokenBatch(const TokenBatch&) = delete;
+    TokenBatch& operator=(const TokenBatch&) = delete;
+
+    std::size_t jobs() const noexcept { return tokens_.size(); }
+    const ProceduralToken& token(std::size_t i) const noexcept { return tokens_[i]; }
+    std::span<float> job(std::size_t i) const noexcept { return outputs_[i]; }
+
+    bool done() const noexcept { return remaining_.load(std::memory_order_acquire) == 0; }
+
+    void wait() const
+    {
+        std::unique_lock lock(mutex_);
+        cv_.wait(lock, [this] { return done(); });
+    }
+
+private:
+    explicit TokenBatch(std::vector<ProceduralToken> tokens) : tokens_(std::move(tokens)), remaining_(tokens_.size()) {}
+
+    /// If queuing fails part-way, the tokens not queued are written off so
+    /// done() can still become true, the queued ones are waited for (no
+    /// task writes to the outputs once submit() has thrown), and the
+    /// error is rethrown.
+    void launch(ThreadPool& pool, const ProceduralRegistry& registry)
+    {
+        std::size_t i = 0;
+        try {
+            for (; i < tokens_.size(); ++i)
+                pool.submit([self = shared_from_this(), &registry, i] {
+                    const std::span<float> out = self->outputs_[i];
+                    registry.render(self->tokens_[i], 0, out.data(), out.size());
+                    self->finish(1);
+                });
+        } catch (...) {
+            finish(tokens_.size() - i);
+            wait();
+            throw;
+        }
+    }
+
+    void finish(std::size_t jobs) noexcept
+    {
+        if (jobs && remaining_.fetch_sub(jobs, std::memory_order_acq_rel) == jobs) {
+            std::lock_guard lock(mutex_);
+            cv_.notify_all();
+        }
+    }
+
+    std::vector<ProceduralToken> tokens_;
+    std::vector<std::span<float>> outputs_;
+    AlignedBuffer<float> storage_;
+    std::atomic<std::size_t> remaining_;
+    mutable std::mutex mutex_;
+    mutable std::condition_variable cv_;
+};
+
+} // namespace asg
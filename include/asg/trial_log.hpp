@@ -0,0 +1,409 @@
+#pragma once
+
+#include <asg/mapped_file.hpp>
+#include <asg/spsc_queue.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace asg {
+
+/// One presented stimulus and the response to it.
+struct TrialRecord {
+    static constexpr std::size_t max_params = 8;
+
+    std::uint64_t onset_sample = 0;
+    std::uint64_t response_sample = 0;
+    std::uint32_t trial = 0;
+    std::uint32_t stimulus = 0;
+    std::int32_t response = 0;
+    float gain = 1.0f;
+    std::array<float, max_params> params{};
+};
+
+/// On-disk layout of the columnar trial log.
+///
+/// The file is a 64 KiB header block followed by fixed-size chunks of
+/// `chunk_records` records. Inside a chunk each field is stored as its own
+/// contiguous column so a scan touches only the columns it filters on, and
+/// every chunk carries a zone map (onset and stimulus ranges) so whole
+/// chunks can be skipped. Fixed chunk size makes chunk k addressable
+/// without an index.
+namespace trial_log_format {
+
+inline constexpr char magic[8] = {'A', 'S', 'G', 'T', 'L', 'O', 'G', '1'};
+inline constexpr std::uint32_t version = 1;
+inline constexpr std::size_t alignment = 64 * 1024; // >= any page size we map on
+
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t param_count;
+    std::uint64_t chunk_records;
+    std::uint64_t chunk_bytes;
+    std::uint64_t chunk_count;
+    std::uint64_t record_count;
+};
+
+struct ChunkHeader {
+    std::uint64_t count;
+    std::uint64_t min_onset;
+    std::uint64_t max_onset;
+    std::uint32_t min_stimulus;
+    std::uint32_t max_stimulus;
+    std::byte pad[32];
+};
+static_assert(sizeof(ChunkHeader) == 64);
+
+inline std::size_t column_bytes(std::size_t records, std::size_t elem)
+{
+    return (records * elem + 63) & ~std::size_t(63);
+}
+
+/// Byte offsets of each column inside a chunk.
+struct ChunkLayout {
+    std::size_t onset, response_sample, trial, stimulus, response, gain;
+    std::array<std::size_t, TrialRecord::max_params> params{};
+    std::size_t bytes;
+
+    ChunkLayout(std::size_t records, std::size_t param_count)
+    {
+        if (param_count > TrialRecord::max_params)
+            throw std::invalid_argument("trial log: too many params");
+        std::size_t off = sizeof(ChunkHeader);
+        onset = off, off += column_bytes(records, 8);
+        response_sample = off, off += column_bytes(records, 8);
+        trial = off, off += column_bytes(records, 4);
+        stimulus = off, off += column_bytes(records, 4);
+        response = off, off += column_bytes(records, 4);
+        gain = off, off += column_bytes(records, 4);
+        for (std::size_t p = 0; p < param_count; ++p)
+            params[p] = off, off += column_bytes(records, 4);
+        bytes = (off + alignment - 1) & ~(alignment - 1);
+    }
+};
+
+} // namespace trial_log_format
+
+/// Append-only trial log writer.
+///
+/// log() is wait-free and may be called from the real-time thread; records
+/// go through an SPSC queue to a background thread that writes them into
+/// the memory-mapped current chunk. The file is grown one chunk at a time.
+class TrialLogWriter {
+public:
+    struct Config {
+        std::size_t param_count = 4;
+        std::size_t chunk_records = 1 << 16;
+        std::size_t queue_capacity = 1 << 14;
+        std::chrono::microseconds idle_sleep{500};
+    };
+
+    TrialLogWriter(const std::string& path, const Config& cfg)
+        : cfg_(cfg),
+          layout_(cfg.chunk_records, cfg.param_count),
+          queue_(cfg.queue_capacity),
+          fd_(FileDescriptor::open(path, O_RDWR | O_CREAT | O_TRUNC))
+    {
+        if (cfg.chunk_records == 0)
+            throw std::invalid_argument("TrialLogWriter: chunk_records must be > 0");
+        fd_.truncate(trial_log_format::alignment);
+        header_ = MappedRegion(fd_, 0, trial_log_format::alignment, true);
+        write_header();
+        thread_ = std::thread([this] { run(); });
+    }
+
+    TrialLogWriter(const TrialLogWriter&) = delete;
+    TrialLogWriter& operator=(const TrialLogWriter&) = delete;
+
+    ~TrialLogWriter()
+    {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+
+    /// Real-time safe. Returns false if the queue is full (record dropped).
+    bool log(const TrialRecord& r) noexcept
+    {
+        if (queue_.try_push(r))
+            return true;
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    std::uint64_t dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+    /// Drain the queue, finalise the header and stop the writer thread.
+    void close()
+    {
+        if (!thread_.joinable())
+            return;
+        stop_.store(true, std::memory_order_release);
+        thread_.join();
+        if (error_)
+            throw std::runtime_error("TrialLogWriter: " + *error_);
+        write_header();
+        header_.sync();
+        if (chunk_.data())
+            chunk_.sync();
+    }
+
+private:
+    void run() noexcept
+    {
+        try {
+            for (;;) {
+                const bool stopping = stop_.load(std::memory_order_acquire);
+                std::size_t n = 0;
+                while (TrialRecord* r = queue_.front()) {
+                    append(*r);
+                    queue_.pop();
+                    ++n;
+                }
+                if (stopping)
+                    break;
+                if (n == 0)
+                    std::this_thread::sleep_for(cfg_.idle_sleep);
+                else
+                    write_header();
+            }
+        } catch (const std::exception& e) {
+            error_ = e.what();
+        }
+    }
+
+    template <typename T>
+    T* column(std::size_t off) noexcept
+    {
+        return reinterpret_cast<T*>(chunk_.data() + off);
+    }
+
+    void next_chunk()
+    {
+        using namespace trial_log_format;
+        chunk_.unmap();
+        const std::uint64_t offset = alignment + chunk_count_ * layout_.bytes;
+        fd_.truncate(offset + layout_.bytes);
+        chunk_ = MappedRegion(fd_, offset, layout_.bytes, true);
+        auto* h = reinterpret_cast<ChunkHeader*>(chunk_.data());
+        *h = ChunkHeader{};
+        h->min_onset = std::numeric_limits<std::uint64_t>::max();
+        h->min_stimulus = std::numeric_limits<std::uint32_t>::max();
+        ++chunk_count_;
+    }
+
+    void append(const TrialRecord& r)
+    {
+        using namespace trial_log_format;
+        if (!chunk_.data() || reinterpret_cast<ChunkHeader*>(chunk_.data())->count == cfg_.chunk_records)
+            next_chunk();
+        auto* h = reinterpret_cast<ChunkHeader*>(chunk_.data());
+        const std::size_t i = h->count;
+        column<std::uint64_t>(layout_.onset)[i] = r.onset_sample;
+        column<std::uint64_t>(layout_.response_sample)[i] = r.response_sample;
+        column<std::uint32_t>(layout_.trial)[i] = r.trial;
+        column<std::uint32_t>(layout_.stimulus)[i] = r.stimulus;
+        column<std::int32_t>(layout_.response)[i] = r.response;
+        column<float>(layout_.gain)[i] = r.gain;
+        for (std::size_t p = 0; p < cfg_.param_count; ++p)
+            column<float>(layout_.params[p])[i] = r.params[p];
+        h->min_onset = std::min(h->min_onset, r.onset_sample);
+        h->max_onset = std::max(h->max_onset, r.onset_sample);
+        h->min_stimulus = std::min(h->min_stimulus, r.stimulus);
+        h->max_stimulus = std::max(h->max_stimulus, r.stimulus);
+        h->count = i + 1;
+        ++records_;
+    }
+
+    void write_header() noexcept
+    {
+        using namespace trial_log_format;
+        FileHeader h{};
+        std::memcpy(h.magic, magic, sizeof magic);
+        h.version = version;
+        h.param_count = static_cast<std::uint32_t>(cfg_.param_count);
+        h.chunk_records = cfg_.chunk_records;
+        h.chunk_bytes = layout_.bytes;
+        h.chunk_count = chunk_count_;
+        h.record_count = records_;
+        std::memcpy(header_.data(), &h, sizeof h);
+    }
+
+    Config cfg_;
+    trial_log_format::ChunkLayout layout_;
+    SpscQueue<TrialRecord> queue_;
+    FileDescriptor fd_;
+    MappedRegion header_;
+    MappedRegion chunk_;
+    std::uint64_t chunk_count_ = 0;
+    std::uint64_t records_ = 0;
+    std::atomic<bool> stop_{false};
+    std::atomic<std::uint64_t> dropped_{0};
+    std::optional<std::string> error_;
+    std::thread thread_;
+};
+
+/// Filter for TrialLogReader::scan(). Unset bounds match everything.
+struct TrialQuery {
+    std::uint64_t onset_begin = 0;
+    std::uint64_t onset_end = std::numeric_limits<std::uint64_t>::max();
+    std::optional<std::uint32_t> stimulus;
+    std::optional<std::int32_t> response;
+};
+
+/// Read-only view of a trial log.
+///
+/// The whole file is mapped; scans skip chunks by zone map and then filter
+/// the remaining chunks column-wise into a selection vector, so only the
+/// filter columns are touched for rejected records.
+class TrialLogReader {
+public:
+    /// Columns of one chunk. Pointers reference the mapped file.
+    struct Chunk {
+        std::size_t count;
+        const std::uint64_t* onset;
+        const std::uint64_t* response_sample;
+        const std::uint32_t* trial;
+        const std::uint32_t* stimulus;
+        const std::int32_t* response;
+        const float* gain;
+        std::array<const float*, TrialRecord::max_params> params;
+
+        TrialRecord record(std::size_t i, std::size_t param_count) const noexcept
+        {
+            TrialRecord r;
+            r.onset_sample = onset[i];
+            r.response_sample = response_sample[i];
+            r.trial = trial[i];
+            r.stimulus = stimulus[i];
+            r.response = response[i];
+            r.gain = gain[i];
+            for (std::size_t p = 0; p < param_count; ++p)
+                r.params[p] = params[p][i];
+            return r;
+        }
+    };
+
+    explicit TrialLogReader(const std::string& path) : file_(path)
+    {
+        using namespace trial_log_format;
+        if (file_.size() < alignment)
+            throw std::runtime_error("TrialLogReader: file too small");
+        std::memcpy(&header_, file_.data(), sizeof header_);
+        if (std::memcmp(header_.magic, magic, sizeof magic) != 0 || header_.version != version)
+            throw std::runtime_error("TrialLogReader: not a trial log or unsupported version");
+        if (header_.param_count > TrialRecord::max_params)
+            throw std::runtime_error("TrialLogReader: corrupt header");
+        const ChunkLayout layout(header_.chunk_records, header_.param_count);
+        if (layout.bytes != header_.chunk_bytes)
+            throw std::runtime_error("TrialLogReader: chunk layout mismatch");
+        // A log from a writer that did not close cleanly may have more
+        // chunks on disk than the header admits; trust what fits.
+        const std::uint64_t on_disk = (file_.size() - alignment) / layout.bytes;
+        const std::uint64_t n = std::min<std::uint64_t>(header_.chunk_count, on_disk);
+        chunks_.reserve(n);
+        for (std::uint64_t k = 0; k < n; ++k) {
+            const std::byte* base = file_.data() + alignment + k * layout.bytes;
+            const auto* h = reinterpret_cast<const ChunkHeader*>(base);
+            Chunk c{};
+            c.count = std::min<std::uint64_t>(h->count, header_.chunk_records);
+            c.onset = reinterpret_cast<const std::uint64_t*>(base + layout.onset);
+            c.response_sample = reinterpret_cast<const std::uint64_t*>(base + layout.response_sample);
+            c.trial = reinterpret_cast<const std::uint32_t*>(base + layout.trial);
+            c.stimulus = reinterpret_cast<const std::uint32_t*>(base + layout.stimulus);
+            c.response = reinterpret_cast<const std::int32_t*>(base + layout.response);
+            c.gain = reinterpret_cast<const float*>(base + layout.gain);
+            for (std::size_t p = 0; p < header_.param_count; ++p)
+                c.params[p] = reinterpret_cast<const float*>(base + layout.params[p]);
+            chunks_.push_back(c);
+            zones_.push_back(*h);
+        }
+        file_.advise(MADV_SEQUENTIAL);
+    }
+
+    std::size_t param_count() const noexcept { return header_.param_count; }
+    std::size_t chunk_count() const noexcept { return chunks_.size(); }
+    const Chunk& chunk(std::size_t k) const noexcept { return chunks_[k]; }
+
+    std::uint64_t size() const noexcept
+    {
+        std::uint64_t n = 0;
+        for (const auto& c : chunks_)
+            n += c.count;
+        return n;
+    }
+
+    /// Call fn(chunk, index) for every record matching q, in file order.
+    template <typename Fn>
+    void scan(const TrialQuery& q, Fn&& fn) const
+    {
+        std::vector<std::uint32_t> sel;
+        std::vector<std::uint8_t> mask;
+        for (std::size_t k = 0; k < chunks_.size(); ++k) {
+            const auto& z = zones_[k];
+            const Chunk& c = chunks_[k];
+            if (c.count == 0 || z.max_onset < q.onset_begin || z.min_onset >= q.onset_end)
+                continue;
+            if (q.stimulus && (*q.stimulus < z.min_stimulus || *q.stimulus > z.max_stimulus))
+                continue;
+
+            mask.assign(c.count, 1);
+            std::uint8_t* m = mask.data();
+            const std::size_t n = c.count;
+            for (std::size_t i = 0; i < n; ++i)
+                m[i] = static_cast<std::uint8_t>(c.onset[i] >= q.onset_begin) & static_cast<std::uint8_t>(c.onset[i] < q.onset_end);
+            if (q.stimulus) {
+                const std::uint32_t s = *q.stimulus;
+                for (std::size_t i = 0; i < n; ++i)
+                    m[i] &= static_cast<std::uint8_t>(c.stimulus[i] == s);
+            }
+            if (q.response) {
+                const std::int32_t r = *q.response;
+                for (std::size_t i = 0; i < n; ++i)
+                    m[i] &= static_cast<std::uint8_t>(c.response[i] == r);
+            }
+
+            sel.clear();
+            for (std::size_t i = 0; i < n; ++i)
+                if (m[i])
+                    sel.push_back(static_cast<std::uint32_t>(i));
+            for (std::uint32_t i : sel)
+                fn(c, static_cast<std::size_t>(i));
+        }
+    }
+
+    std::uint64_t count(const TrialQuery& q) const
+    {
+        std::uint64_t n = 0;
+        scan(q, [&](const Chunk&, std::size_t) { ++n; });
+        return n;
+    }
+
+    std::vector<TrialRecord> select(const TrialQuery& q) const
+    {
+        std::vector<TrialRecord> out;
+        scan(q, [&](const Chunk& c, std::size_t i) { out.push_back(c.record(i, header_.param_count)); });
+        return out;
+    }
+
+private:
+    MappedFile file_;
+    trial_log_format::FileHeader header_{};
+    std::vector<Chunk> chunks_;
+    std::vector<trial_log_format::ChunkHeader> zones_;
+};
+
+} // namespace asg
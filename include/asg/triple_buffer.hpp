@@ -0,0 +1,54 @@
+#pragma once
+
+#include <asg/spsc_queue.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace asg {
+
+/// Lock-free single-writer/single-reader latest-value exchange.
+///
+/// The writer fills back(), then publish(); the reader calls update() and
+/// reads front(). Neither side ever waits, and the reader always sees a
+/// complete snapshot (possibly skipping intermediate ones).
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    explicit TripleBuffer(const T& init) : slots_{init, init, init} {}
+
+    /// Writer side.
+    T& back() noexcept { return slots_[back_]; }
+
+    void publish() noexcept
+    {
+        const std::uint8_t prev = middle_.exchange(static_cast<std::uint8_t>(back_ | dirty), std::memory_order_acq_rel);
+        back_ = prev & index_mask;
+    }
+
+    /// Reader side. Returns true if a new snapshot became front().
+    bool update() noexcept
+    {
+        if (!(middle_.load(std::memory_order_relaxed) & dirty))
+            return false;
+        const std::uint8_t prev = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = prev & index_mask;
+        return true;
+    }
+
+    const T& front() const noexcept { return slots_[front_]; }
+
+private:
+    static constexpr std::uint8_t dirty = 0x4;
+    static constexpr std::uint8_t index_mask = 0x3;
+
+    std::array<T, 3> slots_{};
+    alignas(cache_line) std::atomic<std::uint8_t> middle_{1};
+    alignas(cache_line) std::uint8_t back_ = 0;
+    alignas(cache_line) std::uint8_t front_ = 2;
+};
+
+} // namespace asg
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <asg/mapped_file.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace asg {
+
+enum class SampleFormat { pcm16, pcm24, pcm32, float32 };
+
+inline std::size_t bytes_per_sample(SampleFormat f) noexcept
+{
+    switch (f) {
+    case SampleFormat::pcm16: return 2;
+    case SampleFormat::pcm24: return 3;
+    default: return 4;
+    }
+}
+
+/// Convert `n` samples of one channel from interleaved raw data.
+inline void convert_samples(const std::byte* src, SampleFormat fmt, std::size_t stride, float* out, std::size_t n) noexcept
+{
+    switch (fmt) {
+    case SampleFormat::pcm16:
+        for (std::size_t i = 0; i < n; ++i) {
+            std::int16_t v;
+            std::memcpy(&v, src + i * stride, 2);
+            out[i] = static_cast<float>(v) * (1.0f / 32768.0f);
+        }
+        break;
+    case SampleFormat::pcm24:
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto* p = reinterpret_cast<const std::uint8_t*>(src + i * stride);
+            const std::int32_t v = static_cast<std::int32_t>(static_cast<std::uint32_t>(p[0]) << 8 | static_cast<std::uint32_t>(p[1]) << 16
+                                                             | static_cast<std::uint32_t>(p[2]) << 24) >> 8;
+            out[i] = static_cast<float>(v) * (1.0f / 8388608.0f);
+        }
+        break;
+    case SampleFormat::pcm32:
+        for (std::size_t i = 0; i < n; ++i) {
+            std::int32_t v;
+            std::memcpy(&v, src + i * stride, 4);
+            out[i] = static_cast<float>(v) * (1.0f / 2147483648.0f);
+        }
+        break;
+    case SampleFormat::float32:
+        for (std::size_t i = 0; i < n; ++i)
+            std::memcpy(out + i, src + i * stride, 4);
+        break;
+    }
+}
+
+/// Memory-mapped RIFF/WAVE file. Samples are converted on read, so a
+/// large corpus costs address space, not RAM.
+class MappedWav {
+public:
+    explicit MappedWav(const std::string& path) : file_(path)
+    {
+        const std::byte* p = file_.data();
+        const std::size_t size = file_.size();
+        if (size < 12 || std::memcmp(p, "RIFF", 4) != 0 || std::memcmp(p + 8, "WAVE", 4) != 0)
+            throw std::runtime_error("MappedWav: not a WAVE file: " + path);
+        bool have_fmt = false;
+        std::size_t off = 12;
+        while (off + 8 <= size) {
+            std::uint32_t len;
+            std::memcpy(&len, p + off + 4, 4);
+            const std::byte* body = p + off + 8;
+            const std::size_t avail = std::min<std::size_t>(len, size - off - 8);
+            if (std::memcmp(p + off, "fmt ", 4) == 0 && avail >= 16) {
+                std::uint16_t tag, ch, bits;
+                std::uint32_t rate;
+                std::memcpy(&tag, body, 2);
+                std::memcpy(&ch, body + 2, 2);
+                std::memcpy(&rate, body + 4, 4);
+                std::memcpy(&bits, body + 14, 2);
+                if (tag == 0xFFFE && avail >= 26) // WAVE_FORMAT_EXTENSIBLE: sub-format tag
+                    std::memcpy(&tag, body + 24, 2);
+                channels_ = ch;
+                sample_rate_ = rate;
+                if (tag == 1 && bits == 16)
+                    format_ = SampleFormat::pcm16;
+                else if (tag == 1 && bits == 24)
+                    format_ = SampleFormat::pcm24;
+                else if (tag == 1 && bits == 32)
+                    format_ = SampleFormat::pcm32;
+                else if (tag == 3 && bits == 32)
+                    format_ = SampleFormat::float32;
+                else
+                    throw std::runtime_error("MappedWav: unsupported sample format: " + path);
+                have_fmt = true;
+            } else if (std::memcmp(p + off, "data", 4) == 0) {
+                if (!have_fmt || channels_ == 0)
+                    throw std::runtime_error("MappedWav: data before fmt: " + path);
+                data_ = body;
+                frames_ = avail / (bytes_per_sample(format_) * channels_);
+                return;
+            }
+            off += 8 + len + (len & 1);
+        }
+        throw std::runtime_error("MappedWav: no data chunk: " + path);
+    }
+
+    std::size_t channels() const noexcept { return channels_; }
+    std::size_t frames() const noexcept { return frames_; }
+    double sample_rate() const noexcept { return sample_rate_; }
+    SampleFormat format() const noexcept { return format_; }
+
+    /// Copy `n` frames of `channel` starting at `first` into `out`,
+    /// zero-filling past the end.
+    void read(std::size_t channel, std::size_t first, float* out, std::size_t n) const noexcept
+    {
+        const std::size_t bps = bytes_per_sample(format_);
+        const std::size_t avail = first < frames_ ? std::min(n, frames_ - first) : 0;
+        convert_samples(data_ + (first * channels_ + channel) * bps, format_, bps * channels_, out, avail);
+        std::fill(out + avail, out + n, 0.0f);
+    }
+
+    /// Raw interleaved sample data, for callers that convert themselves.
+    const std::byte* data() const noexcept { return data_; }
+
+    /// madvise() the whole mapping, e.g. MADV_RANDOM for a large corpus.
+    void advise(int advice) const noexcept { file_.advise(advice); }
+
+private:
+    MappedFile file_;
+    const std::byte* data_ = nullptr;
+    std::size_t channels_ = 0;
+    std::size_t frames_ = 0;
+    double sample_rate_ = 0.0;
+    SampleFormat format_ = SampleFormat::pcm16;
+};
+
+/// Write interleaved float samples as a 32-bit float WAVE file.
+inline void write_wav(const std::string& path, const float* interleaved, std::size_t frames, std::size_t channels, double sample_rate)
+{
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (!f)
+        throw std::runtime_error("write_wav: cannot open " + path);
+    const auto u32 = [&](std::uint32_t v) { f.write(reinterpret_cast<const char*>(&v), 4); };
+    const auto u16 = [&](std::uint16_t v) { f.write(reinterpret_cast<const char*>(&v), 2); };
+    const auto data_bytes = static_cast<std::uint32_t>(frames * channels * 4);
+    const auto rate = static_cast<std::uint32_t>(sample_rate);
+    f.write("RIFF", 4);
+    u32(36 + data_bytes);
+    f.write("WAVEfmt ", 8);
+    u32(16);
+    u16(3);
+    u16(static_cast<std::uint16_t>(channels));
+    u32(rate);
+    u32(rate * static_cast<std::uint32_t>(channels) * 4);
+    u16(static_cast<std::uint16_t>(channels * 4));
+    u16(32);
+    f.write("data", 4);
+    u32(data_bytes);
+    f.write(reinterpret_cast<const char*>(interleaved), static_cast<std::streamsize>(data_bytes));
+    if (!f)
+        throw std::runtime_error("write_wav: write failed: " + path);
+}
+
+} // namespace asg
@@ -0,0 +1,302 @@
+#pragma once
+
+#include <asg/aligned_buffer.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace asg {
+
+/// Multiband wide-dynamic-range compressor for aided-listening simulation.
+///
+/// The filterbank is a Linkwitz-Riley (4th-order) crossover tree with
+/// allpass compensation: band k is the high-pass of every lower crossover,
+/// the low-pass of crossover k, and the 2nd-order allpass of every higher
+/// crossover, so the bands sum to an allpass (flat magnitude) with no
+/// latency beyond the filters' group delay. Bands are padded to the same
+/// number of biquad stages with identity sections, and state and
+/// coefficients are stored per stage as arrays over bands. Processing runs
+/// in short blocks one stage at a time, so every stage is a vector
+/// recursion over the block with its state held in registers.
+///
+/// Each band's envelope follower is a branch-free one-pole with separate
+/// attack and release coefficients. The static compression curve is
+/// evaluated from a per-band gain table indexed directly by the bits of
+/// the float envelope (exponent plus top mantissa bits, i.e. 1/16-octave
+/// steps, linearly interpolated), so no log or exp runs per sample.
+class WdrcCompressor {
+public:
+    struct Band {
+        float threshold_db = -40.0f; ///< compression knee, dBFS (peak)
+        float ratio = 2.0f;
+        float gain_db = 0.0f;        ///< linear gain below the knee
+        float attack_ms = 5.0f;
+        float release_ms = 50.0f;
+    };
+
+    struct Config {
+        double sample_rate = 48000.0;
+        std::size_t bands = 8;              ///< 2..32
+        double f_lo = 250.0;                ///< lowest crossover
+        double f_hi = 6000.0;               ///< highest crossover
+        std::vector<double> crossovers;     ///< bands - 1 ascending; overrides f_lo/f_hi
+        std::vector<Band> settings;         ///< per band; the last entry repeats
+    };
+
+    static constexpr std::size_t max_bands = 32;
+
+    explicit WdrcCompressor(const Config& cfg)
+        : cfg_(cfg),
+          bands_(cfg.bands),
+          width_((cfg.bands + lanes - 1) / lanes * lanes),
+          stages_(cfg.bands >= 2 ? 2 * (cfg.bands - 1) : 0),
+          coeff_(stages_ * 5 * width_),
+          state_(stages_ * 2 * width_),
+          work_(block * width_),
+          env_(width_),
+          gain_(width_),
+          attack_(width_),
+          release_(width_),
+          table_(width_ * table_stride)
+    {
+        if (cfg.bands < 2 || cfg.bands > max_bands)
+            throw std::invalid_argument("WdrcCompressor: bands must be in [2, 32]");
+        std::vector<double> xo = cfg.crossovers;
+        if (xo.empty()) {
+            for (std::size_t k = 0; k + 1 < cfg.bands; ++k)
+                xo.push_back(cfg.f_lo * std::pow(cfg.f_hi / cfg.f_lo, cfg.bands > 2 ? double(k) / double(cfg.bands - 2) : 0.0));
+        }
+        if (xo.size() != cfg.bands - 1 || !std::is_sorted(xo.begin(), xo.end()) || xo.front() <= 0.0
+            || xo.back() >= cfg.sample_rate / 2)
+            throw std::invalid_argument("WdrcCompressor: need bands - 1 ascending crossovers below Nyquist");
+
+        for (std::size_t b = 0; b < width_; ++b)
+            for (std::size_t s = 0; s < stages_; ++s)
+                set_biquad(s, b, identity());
+        for (std::size_t b = 0; b < bands_; ++b) {
+            std::size_t stage = 0;
+            for (std::size_t j = 0; j < b; ++j) {
+                set_biquad(stage++, b, butterworth(xo[j], true));
+                set_biquad(stage++, b, butterworth(xo[j], true));
+            }
+            if (b + 1 < bands_) {
+                set_biquad(stage++, b, butterworth(xo[b], false));
+                set_biquad(stage++, b, butterworth(xo[b], false));
+            }
+            for (std::size_t j = b + 1; j + 1 < bands_; ++j)
+                set_biquad(stage++, b, allpass(xo[j]));
+            const Band& s = setting(b);
+            attack_[b] = one_pole(s.attack_ms);
+            release_[b] = one_pole(s.release_ms);
+            build_table(b, s);
+        }
+        reset();
+    }
+
+    std::size_t bands() const noexcept { return bands_; }
+
+    /// Current gain of band `b` in linear units, for metering.
+    float band_gain(std::size_t b) const noexcept { return gain_[b]; }
+
+    void reset() noexcept
+    {
+        std::fill(state_.begin(), state_.end(), 0.0f);
+        std::fill(env_.begin(), env_.end(), 0.0f);
+        for (std::size_t b = 0; b < width_; ++b)
+            gain_[b] = b < bands_ ? table_[b * table_stride] : 0.0f;
+    }
+
+    /// Compress `frames` samples; `in` and `out` may alias.
+    void process(const float* in, float* out, std::size_t frames) noexcept
+    {
+        switch (width_) {
+        case 8: run<8>(in, out, frames); break;
+        case 16: run<16>(in, out, frames); break;
+        case 24: run<24>(in, out, frames); break;
+        default: run<32>(in, out, frames); break;
+        }
+    }
+
+private:
+    static constexpr std::size_t lanes = 8;
+    static constexpr std::size_t block = 64;
+
+    /// All bands at once, W (the padded band count) known at compile time:
+    /// the W / 8 vector recursions of a stage are independent, which hides
+    /// the latency of each one.
+    template <std::size_t W>
+    void run(const float* in, float* out, std::size_t frames) noexcept
+    {
+        float* __restrict v = work_.data();
+        for (std::size_t done = 0; done < frames;) {
+            const std::size_t n = std::min(block, frames - done);
+            for (std::size_t i = 0; i < n; ++i)
+                for (std::size_t l = 0; l < W; ++l)
+                    v[i * W + l] = in[done + i];
+            for (std::size_t s = 0; s < stages_; ++s)
+                biquad<W>(s, v, n);
+            compress<W>(v, out + done, n);
+            done += n;
+        }
+    }
+
+    // Gain table domain: envelope 2^-24 .. 2^8 in 1/16-octave steps.
+    static constexpr int table_min_exp = -24;
+    static constexpr int table_octaves = 32;
+    static constexpr int table_steps = 16;
+    static constexpr int table_shift = 23 - 4; // keep 4 mantissa bits
+    static constexpr std::size_t table_stride = table_octaves * table_steps + 2;
+
+    struct Biquad {
+        float b0, b1, b2, a1, a2;
+    };
+
+    static Biquad identity() noexcept { return {1.0f, 0.0f, 0.0f, 0.0f, 0.0f}; }
+
+    /// RBJ Butterworth (Q = 1/sqrt 2) low- or high-pass.
+    Biquad butterworth(double f, bool highpass) const noexcept
+    {
+        const double w = 2.0 * 3.14159265358979323846 * f / cfg_.sample_rate;
+        const double cw = std::cos(w);
+        const double alpha = std::sin(w) / (2.0 * 0.70710678118654752);
+        const double a0 = 1.0 + alpha;
+        const double b1 = highpass ? -(1.0 + cw) : 1.0 - cw;
+        const double b0 = highpass ? (1.0 + cw) / 2.0 : (1.0 - cw) / 2.0;
+        return {float(b0 / a0), float(b1 / a0), float(b0 / a0), float(-2.0 * cw / a0), float((1.0 - alpha) / a0)};
+    }
+
+    /// 2nd-order allpass with the same poles; equals LR4 low + high pass.
+    Biquad allpass(double f) const noexcept
+    {
+        const double w = 2.0 * 3.14159265358979323846 * f / cfg_.sample_rate;
+        const double cw = std::cos(w);
+        const double alpha = std::sin(w) / (2.0 * 0.70710678118654752);
+        const double a0 = 1.0 + alpha;
+        return {float((1.0 - alpha) / a0), float(-2.0 * cw / a0), 1.0f, float(-2.0 * cw / a0), float((1.0 - alpha) / a0)};
+    }
+
+    const Band& setting(std::size_t b) const noexcept
+    {
+        static const Band fallback{};
+        if (cfg_.settings.empty())
+            return fallback;
+        return cfg_.settings[std::min(b, cfg_.settings.size() - 1)];
+    }
+
+    float one_pole(float ms) const noexcept
+    {
+        const double n = std::max(1e-3, double(ms) * 1e-3 * cfg_.sample_rate);
+        return static_cast<float>(1.0 - std::exp(-1.0 / n));
+    }
+
+    float* coeff(std::size_t s, std::size_t k) noexcept { return coeff_.data() + (s * 5 + k) * width_; }
+
+    void set_biquad(std::size_t s, std::size_t b, const Biquad& q) noexcept
+    {
+        coeff(s, 0)[b] = q.b0;
+        coeff(s, 1)[b] = q.b1;
+        coeff(s, 2)[b] = q.b2;
+        coeff(s, 3)[b] = q.a1;
+        coeff(s, 4)[b] = q.a2;
+    }
+
+    /// One transposed direct-form II stage over a block for all bands.
+    /// `v` is sample-major: v[i * W + band].
+    template <std::size_t W>
+    void biquad(std::size_t s, float* __restrict v, std::size_t n) noexcept
+    {
+        float c0[W], c1[W], c2[W], d1[W], d2[W], z1[W], z2[W];
+        float* const zs1 = state_.data() + (s * 2) * W;
+        float* const zs2 = state_.data() + (s * 2 + 1) * W;
+        for (std::size_t l = 0; l < W; ++l) {
+            c0[l] = coeff(s, 0)[l];
+            c1[l] = coeff(s, 1)[l];
+            c2[l] = coeff(s, 2)[l];
+            d1[l] = coeff(s, 3)[l];
+            d2[l] = coeff(s, 4)[l];
+            z1[l] = zs1[l];
+            z2[l] = zs2[l];
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            float* __restrict x = v + i * W;
+            for (std::size_t l = 0; l < W; ++l) {
+                const float y = c0[l] * x[l] + z1[l];
+                z1[l] = c1[l] * x[l] - d1[l] * y + z2[l];
+                z2[l] = c2[l] * x[l] - d2[l] * y;
+                x[l] = y;
+            }
+        }
+        for (std::size_t l = 0; l < W; ++l) {
+            zs1[l] = z1[l];
+            zs2[l] = z2[l];
+        }
+    }
+
+    /// Envelope, table gain and mix-down. Padding bands have an all-zero
+    /// table, so they contribute nothing.
+    template <std::size_t W>
+    void compress(const float* __restrict v, float* out, std::size_t n) noexcept
+    {
+        float env[W], att[W], rel[W], g[W];
+        for (std::size_t l = 0; l < W; ++l) {
+            env[l] = env_[l];
+            att[l] = attack_[l];
+            rel[l] = release_[l];
+            g[l] = gain_[l];
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            const float* x = v + i * W;
+            float y = 0.0f;
+            for (std::size_t l = 0; l < W; ++l) {
+                const float level = std::fabs(x[l]);
+                const float k = level > env[l] ? att[l] : rel[l];
+                env[l] += k * (level - env[l]);
+                g[l] = lookup(l, env[l]);
+                y += g[l] * x[l];
+            }
+            out[i] = y;
+        }
+        for (std::size_t l = 0; l < W; ++l) {
+            env_[l] = env[l];
+            gain_[l] = g[l];
+        }
+    }
+
+    void build_table(std::size_t b, const Band& s) noexcept
+    {
+        float* t = table_.data() + b * table_stride;
+        const double g0 = std::pow(10.0, s.gain_db / 20.0);
+        const double knee = std::pow(10.0, s.threshold_db / 20.0);
+        const double slope = 1.0 / std::max(1.0f, s.ratio) - 1.0;
+        for (std::size_t j = 0; j < table_stride; ++j) {
+            const double level = std::ldexp(1.0 + double(j % table_steps) / table_steps, table_min_exp + int(j / table_steps));
+            t[j] = static_cast<float>(level > knee ? g0 * std::pow(level / knee, slope) : g0);
+        }
+    }
+
+    /// Table index from the float's exponent and top mantissa bits;
+    /// the remaining mantissa bits interpolate between entries.
+    float lookup(std::size_t b, float env) const noexcept
+    {
+        constexpr float lo = 0x1.0p-24f;
+        constexpr float hi = 0x1.fffffep7f;
+        const std::uint32_t bits = std::bit_cast<std::uint32_t>(std::clamp(env, lo, hi));
+        const std::uint32_t j = (bits >> table_shift) - (static_cast<std::uint32_t>(127 + table_min_exp) << 4);
+        const float f = static_cast<float>(bits & ((1u << table_shift) - 1)) * (1.0f / (1u << table_shift));
+        const float* t = table_.data() + b * table_stride + j;
+        return t[0] + f * (t[1] - t[0]);
+    }
+
+    Config cfg_;
+    std::size_t bands_;
+    std::size_t width_;
+    std::size_t stages_;
+    AlignedBuffer<float> coeff_, state_, work_, env_, gain_, attack_, release_, table_;
+};
+
+} // namespace asg
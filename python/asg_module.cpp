@@ -0,0 +1,489 @@
+// CPython extension `asg`: procedural token rendering with zero-copy
+// buffer-protocol output.
+//
+// Build as an extension module against the library headers, e.g.
+//
+//     c++ -std=c++20 -O2 -shared -fPIC -pthread -Iinclude $(python3-config --includes)
+//         python/asg_module.cpp -o asg$(python3-config --extension-suffix)
+//
+// Tokens are tuples (generator, length[, seed[, ramp[, params]]]) with the
+// generator ids exported as TONE, NOISE, HARMONIC and SAM_NOISE.
+//
+//     e = asg.Engine(threads=8, sample_rate=48000)
+//     job = e.submit([(asg.NOISE, 48000, seed, 240, (0.1,)) for seed in range(1000)])
+//     x = numpy.asarray(job[3])          # view of the batch's own buffer
+//     e.submit_into(tokens, arrays).wait()  # render into float32 arrays in place
+//
+// Rendering runs on the engine's ThreadPool without the GIL; Job.wait()
+// and Engine.render() release it while they block or compute.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <asg/procedural.hpp>
+#include <asg/thread_pool.hpp>
+#include <asg/token_batch.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/// Registry and pool shared by an Engine and its Jobs; the pool is
+/// declared last so it is joined while the registry is still alive.
+struct EngineState {
+    EngineState(std::size_t threads, double sample_rate) : registry(sample_rate), pool(threads) {}
+
+    asg::ProceduralRegistry registry;
+    asg::ThreadPool pool;
+};
+
+struct EngineObject {
+    PyObject_HEAD
+    std::shared_ptr<EngineState> state;
+};
+
+struct JobObject {
+    PyObject_HEAD
+    std::shared_ptr<EngineState> state;
+    std::shared_ptr<asg::TokenBatch> batch;
+    std::vector<Py_buffer>* views; ///< caller-owned outputs, released after the batch
+                                   ///< (batch is null only while submit_into builds the job)
+};
+
+/// One job's samples, exported through the buffer protocol. Holds its
+/// Job, and with it the batch's buffer or the export of the caller's
+/// array, so the memory outlives every view taken from the Buffer.
+struct BufferObject {
+    PyObject_HEAD
+    PyObject* job;
+    float* data;
+    Py_ssize_t shape[1];
+    Py_ssize_t strides[1];
+};
+
+extern PyTypeObject EngineType;
+extern PyTypeObject JobType;
+extern PyTypeObject BufferType;
+
+// ---------------------------------------------------------------------------
+// Tokens and buffers
+
+bool parse_token(PyObject* item, asg::ProceduralToken& t)
+{
+    unsigned int generator = 0, ramp = 0;
+    unsigned long long length = 0, seed = 0;
+    PyObject* params = nullptr;
+    if (!PyTuple_Check(item)) {
+        PyErr_SetString(PyExc_TypeError, "token must be a tuple (generator, length[, seed[, ramp[, params]]])");
+        return false;
+    }
+    if (!PyArg_ParseTuple(item, "IK|KIO", &generator, &length, &seed, &ramp, &params))
+        return false;
+    t = {};
+    t.generator = generator;
+    t.length = length;
+    t.seed = seed;
+    t.ramp = ramp;
+    if (params && params != Py_None) {
+        PyObject* seq = PySequence_Fast(params, "token params must be a sequence");
+        if (!seq)
+            return false;
+        const Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+        if (n > static_cast<Py_ssize_t>(asg::ProceduralToken::max_params)) {
+            Py_DECREF(seq);
+            PyErr_SetString(PyExc_ValueError, "too many token params");
+            return false;
+        }
+        for (Py_ssize_t i = 0; i < n; ++i) {
+            const double v = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(seq, i));
+            if (v == -1.0 && PyErr_Occurred()) {
+                Py_DECREF(seq);
+                return false;
+            }
+            t.params[static_cast<std::size_t>(i)] = static_cast<float>(v);
+        }
+        Py_DECREF(seq);
+    }
+    return true;
+}
+
+bool parse_tokens(PyObject* obj, std::vector<asg::ProceduralToken>& tokens)
+{
+    PyObject* seq = PySequence_Fast(obj, "tokens must be a sequence");
+    if (!seq)
+        return false;
+    const Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    tokens.resize(static_cast<std::size_t>(n));
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        if (!parse_token(PySequence_Fast_GET_ITEM(seq, i), tokens[static_cast<std::size_t>(i)])) {
+            Py_DECREF(seq);
+            return false;
+        }
+    }
+    Py_DECREF(seq);
+    return true;
+}
+
+/// A writable, contiguous float32 view of `obj`.
+bool get_float_buffer(PyObject* obj, Py_buffer& view)
+{
+    if (PyObject_GetBuffer(obj, &view, PyBUF_WRITABLE | PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0)
+        return false;
+    const char* f = view.format ? view.format : "B";
+    const char type = f[0] == '<' || f[0] == '=' || f[0] == '@' ? f[1] : f[0];
+    if (view.itemsize != sizeof(float) || type != 'f' || f[0] == '>' || f[0] == '!') {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_TypeError, "output must be a native float32 buffer");
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Buffer
+
+void buffer_dealloc(PyObject* self)
+{
+    Py_DECREF(reinterpret_cast<BufferObject*>(self)->job);
+    Py_TYPE(self)->tp_free(self);
+}
+
+int buffer_getbuffer(PyObject* self, Py_buffer* view, int flags)
+{
+    auto* b = reinterpret_cast<BufferObject*>(self);
+    view->obj = Py_NewRef(self);
+    view->buf = b->data;
+    view->len = b->shape[0] * static_cast<Py_ssize_t>(sizeof(float));
+    view->readonly = 0;
+    view->itemsize = sizeof(float);
+    view->format = (flags & PyBUF_FORMAT) ? const_cast<char*>("f") : nullptr;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? b->shape : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? b->strides : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    return 0;
+}
+
+Py_ssize_t buffer_length(PyObject* self)
+{
+    return reinterpret_cast<BufferObject*>(self)->shape[0];
+}
+
+PyBufferProcs buffer_procs = {buffer_getbuffer, nullptr};
+PySequenceMethods buffer_sequence{};
+
+PyObject* make_buffer(PyObject* job, std::size_t i)
+{
+    auto* b = PyObject_New(BufferObject, &BufferType);
+    if (!b)
+        return nullptr;
+    b->job = Py_NewRef(job);
+    const std::span<float> s = reinterpret_cast<JobObject*>(job)->batch->job(i);
+    b->data = s.data();
+    b->shape[0] = static_cast<Py_ssize_t>(s.size());
+    b->strides[0] = sizeof(float);
+    return reinterpret_cast<PyObject*>(b);
+}
+
+// ---------------------------------------------------------------------------
+// Job
+
+void job_wait_nogil(JobObject* j)
+{
+    if (!j->batch || j->batch->done())
+        return;
+    Py_BEGIN_ALLOW_THREADS
+    j->batch->wait();
+    Py_END_ALLOW_THREADS
+}
+
+void job_dealloc(PyObject* self)
+{
+    auto* j = reinterpret_cast<JobObject*>(self);
+    if (j->views) {
+        // The pool may still be writing into the caller's arrays.
+        job_wait_nogil(j);
+        for (Py_buffer& v : *j->views)
+            PyBuffer_Release(&v);
+        delete j->views;
+    }
+    j->batch.~shared_ptr();
+    j->state.~shared_ptr();
+    Py_TYPE(self)->tp_free(self);
+}
+
+PyObject* job_done(PyObject* self, PyObject*)
+{
+    return PyBool_FromLong(reinterpret_cast<JobObject*>(self)->batch->done());
+}
+
+PyObject* job_wait(PyObject* self, PyObject*)
+{
+    job_wait_nogil(reinterpret_cast<JobObject*>(self));
+    Py_RETURN_NONE;
+}
+
+Py_ssize_t job_length(PyObject* self)
+{
+    return static_cast<Py_ssize_t>(reinterpret_cast<JobObject*>(self)->batch->jobs());
+}
+
+/// job[i]: waits for the batch, then a zero-copy Buffer over job i.
+PyObject* job_item(PyObject* self, Py_ssize_t i)
+{
+    auto* j = reinterpret_cast<JobObject*>(self);
+    if (i < 0 || static_cast<std::size_t>(i) >= j->batch->jobs()) {
+        PyErr_SetString(PyExc_IndexError, "job index out of range");
+        return nullptr;
+    }
+    job_wait_nogil(j);
+    return make_buffer(self, static_cast<std::size_t>(i));
+}
+
+PyMethodDef job_methods[] = {
+    {"done", job_done, METH_NOARGS, "True once every token has been rendered."},
+    {"wait", job_wait, METH_NOARGS, "Block, without the GIL, until the batch is rendered."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PySequenceMethods job_sequence{};
+
+PyObject* make_job(const std::shared_ptr<EngineState>& state, std::shared_ptr<asg::TokenBatch> batch,
+                   std::vector<Py_buffer>* views)
+{
+    auto* j = PyObject_New(JobObject, &JobType);
+    if (!j)
+        return nullptr;
+    new (&j->state) std::shared_ptr<EngineState>(state);
+    new (&j->batch) std::shared_ptr<asg::TokenBatch>(std::move(batch));
+    j->views = views;
+    return reinterpret_cast<PyObject*>(j);
+}
+
+// ---------------------------------------------------------------------------
+// Engine
+
+PyObject* engine_new(PyTypeObject* type, PyObject* args, PyObject* kwargs)
+{
+    static const char* keywords[] = {"threads", "sample_rate", nullptr};
+    Py_ssize_t threads = 0;
+    double sample_rate = 48000.0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|nd", const_cast<char**>(keywords), &threads, &sample_rate))
+        return nullptr;
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must be >= 0");
+        return nullptr;
+    }
+    auto* e = reinterpret_cast<EngineObject*>(type->tp_alloc(type, 0));
+    if (!e)
+        return nullptr;
+    new (&e->state) std::shared_ptr<EngineState>();
+    try {
+        const std::size_t n = threads ? static_cast<std::size_t>(threads) : std::max(1u, std::thread::hardware_concurrency());
+        e->state = std::make_shared<EngineState>(n, sample_rate);
+    } catch (const std::exception& ex) {
+        Py_DECREF(e);
+        PyErr_SetString(PyExc_ValueError, ex.what());
+        return nullptr;
+    }
+    return reinterpret_cast<PyObject*>(e);
+}
+
+void engine_dealloc(PyObject* self)
+{
+    auto* e = reinterpret_cast<EngineObject*>(self);
+    if (e->state.use_count() == 1) {
+        // Joining the pool may wait on running renders.
+        Py_BEGIN_ALLOW_THREADS
+        e->state.reset();
+        Py_END_ALLOW_THREADS
+    }
+    e->state.~shared_ptr();
+    Py_TYPE(self)->tp_free(self);
+}
+
+/// submit(tokens) -> Job rendering into memory owned by the job.
+PyObject* engine_submit(PyObject* self, PyObject* tokens_obj)
+{
+    auto* e = reinterpret_cast<EngineObject*>(self);
+    std::vector<asg::ProceduralToken> tokens;
+    if (!parse_tokens(tokens_obj, tokens))
+        return nullptr;
+    std::shared_ptr<asg::TokenBatch> batch;
+    try {
+        batch = asg::TokenBatch::submit(e->state->pool, e->state->registry, std::move(tokens));
+    } catch (const std::bad_alloc&) {
+        return PyErr_NoMemory();
+    } catch (const std::exception& ex) {
+        PyErr_SetString(PyExc_RuntimeError, ex.what());
+        return nullptr;
+    }
+    return make_job(e->state, std::move(batch), nullptr);
+}
+
+/// submit_into(tokens, outputs) -> Job rendering into writable float32
+/// buffers, one per token; each receives len(output) samples.
+PyObject* engine_submit_into(PyObject* self, PyObject* args)
+{
+    auto* e = reinterpret_cast<EngineObject*>(self);
+    PyObject *tokens_obj, *outputs_obj;
+    if (!PyArg_ParseTuple(args, "OO", &tokens_obj, &outputs_obj))
+        return nullptr;
+    std::vector<asg::ProceduralToken> tokens;
+    if (!parse_tokens(tokens_obj, tokens))
+        return nullptr;
+    PyObject* seq = PySequence_Fast(outputs_obj, "outputs must be a sequence");
+    if (!seq)
+        return nullptr;
+    if (PySequence_Fast_GET_SIZE(seq) != static_cast<Py_ssize_t>(tokens.size())) {
+        Py_DECREF(seq);
+        PyErr_SetString(PyExc_ValueError, "need one output per token");
+        return nullptr;
+    }
+    // The Job owns the exports from the start, so every failure below
+    // releases them through job_dealloc. Nothing is queued until the last
+    // fallible step, and a failing submit() has already waited for any
+    // task it queued.
+    PyObject* job = make_job(e->state, nullptr, nullptr);
+    if (!job) {
+        Py_DECREF(seq);
+        return nullptr;
+    }
+    auto* j = reinterpret_cast<JobObject*>(job);
+    try {
+        j->views = new std::vector<Py_buffer>();
+        j->views->reserve(tokens.size());
+        std::vector<std::span<float>> outputs;
+        outputs.reserve(tokens.size());
+        for (std::size_t i = 0; i < tokens.size(); ++i) {
+            Py_buffer v;
+            if (!get_float_buffer(PySequence_Fast_GET_ITEM(seq, static_cast<Py_ssize_t>(i)), v)) {
+                Py_DECREF(seq);
+                Py_DECREF(job);
+                return nullptr;
+            }
+            j->views->push_back(v);
+            outputs.emplace_back(static_cast<float*>(v.buf), static_cast<std::size_t>(v.len) / sizeof(float));
+        }
+        Py_CLEAR(seq);
+        j->batch = asg::TokenBatch::submit(e->state->pool, e->state->registry, std::move(tokens), std::move(outputs));
+    } catch (const std::bad_alloc&) {
+        Py_XDECREF(seq);
+        Py_DECREF(job);
+        return PyErr_NoMemory();
+    } catch (const std::exception& ex) {
+        Py_XDECREF(seq);
+        Py_DECREF(job);
+        PyErr_SetString(PyExc_RuntimeError, ex.what());
+        return nullptr;
+    }
+    return job;
+}
+
+/// render(token, out, first=0): synchronous render of samples
+/// [first, first + len(out)) into a float32 buffer, without the GIL.
+PyObject* engine_render(PyObject* self, PyObject* args, PyObject* kwargs)
+{
+    static const char* keywords[] = {"token", "out", "first", nullptr};
+    auto* e = reinterpret_cast<EngineObject*>(self);
+    PyObject *token_obj, *out_obj;
+    unsigned long long first = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|K", const_cast<char**>(keywords), &token_obj, &out_obj, &first))
+        return nullptr;
+    asg::ProceduralToken token;
+    if (!parse_token(token_obj, token))
+        return nullptr;
+    Py_buffer v;
+    if (!get_float_buffer(out_obj, v))
+        return nullptr;
+    const asg::ProceduralRegistry& registry = e->state->registry;
+    Py_BEGIN_ALLOW_THREADS
+    registry.render(token, first, static_cast<float*>(v.buf), static_cast<std::size_t>(v.len) / sizeof(float));
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&v);
+    Py_RETURN_NONE;
+}
+
+PyObject* engine_threads(PyObject* self, void*)
+{
+    return PyLong_FromSize_t(reinterpret_cast<EngineObject*>(self)->state->pool.size());
+}
+
+PyObject* engine_sample_rate(PyObject* self, void*)
+{
+    return PyFloat_FromDouble(reinterpret_cast<EngineObject*>(self)->state->registry.sample_rate());
+}
+
+PyMethodDef engine_methods[] = {
+    {"submit", engine_submit, METH_O, "submit(tokens) -> Job; render into job-owned buffers."},
+    {"submit_into", engine_submit_into, METH_VARARGS, "submit_into(tokens, outputs) -> Job; render into float32 buffers."},
+    {"render", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(engine_render)), METH_VARARGS | METH_KEYWORDS,
+     "render(token, out, first=0); synchronous render into a float32 buffer."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyGetSetDef engine_getset[] = {
+    {"threads", engine_threads, nullptr, "Worker threads in the pool.", nullptr},
+    {"sample_rate", engine_sample_rate, nullptr, "Sample rate of the generators.", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr},
+};
+
+PyTypeObject make_type(const char* name, const char* doc, Py_ssize_t size, destructor dealloc)
+{
+    PyTypeObject t{};
+    t.ob_base = PyVarObject{PyObject_HEAD_INIT(nullptr) 0};
+    t.tp_name = name;
+    t.tp_doc = doc;
+    t.tp_basicsize = size;
+    t.tp_dealloc = dealloc;
+    t.tp_flags = Py_TPFLAGS_DEFAULT;
+    return t;
+}
+
+PyTypeObject EngineType = make_type("asg.Engine", "Engine(threads=0, sample_rate=48000.0): generator registry and worker pool.",
+                                    sizeof(EngineObject), engine_dealloc);
+PyTypeObject JobType = make_type("asg.Job", "A batch of tokens rendering on an Engine's pool.", sizeof(JobObject), job_dealloc);
+PyTypeObject BufferType = make_type("asg.Buffer", "Rendered samples of one token (float32, buffer protocol).",
+                                    sizeof(BufferObject), buffer_dealloc);
+
+PyModuleDef module = {PyModuleDef_HEAD_INIT, "asg", "Auditory stimulus generation.", -1, nullptr, nullptr, nullptr, nullptr, nullptr};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit_asg()
+{
+    EngineType.tp_new = engine_new;
+    EngineType.tp_methods = engine_methods;
+    EngineType.tp_getset = engine_getset;
+    JobType.tp_methods = job_methods;
+    job_sequence.sq_length = job_length;
+    job_sequence.sq_item = job_item;
+    JobType.tp_as_sequence = &job_sequence;
+    BufferType.tp_as_buffer = &buffer_procs;
+    buffer_sequence.sq_length = buffer_length;
+    BufferType.tp_as_sequence = &buffer_sequence;
+    for (PyTypeObject* t : {&EngineType, &JobType, &BufferType})
+        if (PyType_Ready(t) < 0)
+            return nullptr;
+
+    PyObject* m = PyModule_Create(&module);
+    if (!m)
+        return nullptr;
+    if (PyModule_AddObjectRef(m, "Engine", reinterpret_cast<PyObject*>(&EngineType)) < 0
+        || PyModule_AddIntConstant(m, "TONE", asg::procedural_tone) < 0
+        || PyModule_AddIntConstant(m, "NOISE", asg::procedural_noise) < 0
+        || PyModule_AddIntConstant(m, "HARMONIC", asg::procedural_harmonic) < 0
+        || PyModule_AddIntConstant(m, "SAM_NOISE", asg::procedural_sam_noise) < 0) {
+        Py_DECREF(m);
+        return nullptr;
+    }
+    return m;
+}
@@ -0,0 +1,252 @@
+// Implementation of the C interface in <asg/asg.h>.
+
+#ifndef ASG_BUILDING
+#define ASG_BUILDING 1
+#endif
+#include <asg/asg.h>
+
+#include <asg/procedural.hpp>
+#include <asg/spsc_queue.hpp>
+#include <asg/thread_pool.hpp>
+#include <asg/token_batch.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+static_assert(sizeof(asg_token) == sizeof(asg::ProceduralToken));
+static_assert(offsetof(asg_token, generator) == offsetof(asg::ProceduralToken, generator));
+static_assert(offsetof(asg_token, ramp) == offsetof(asg::ProceduralToken, ramp));
+static_assert(offsetof(asg_token, seed) == offsetof(asg::ProceduralToken, seed));
+static_assert(offsetof(asg_token, length) == offsetof(asg::ProceduralToken, length));
+static_assert(offsetof(asg_token, params) == offsetof(asg::ProceduralToken, params));
+static_assert(ASG_TOKEN_PARAMS == asg::ProceduralToken::max_params);
+static_assert(ASG_TONE == int(asg::procedural_tone) && ASG_NOISE == int(asg::procedural_noise)
+              && ASG_HARMONIC == int(asg::procedural_harmonic) && ASG_SAM_NOISE == int(asg::procedural_sam_noise));
+
+namespace {
+
+struct Scheduled {
+    asg::ProceduralToken token;
+    std::uint64_t at;
+    float gain;
+};
+
+/// Per-thread error text: a fixed buffer, so reporting never allocates.
+thread_local char last_error[256] = "";
+
+asg_status fail(asg_status s, const char* message) noexcept
+{
+    std::strncpy(last_error, message, sizeof last_error - 1);
+    last_error[sizeof last_error - 1] = '\0';
+    return s;
+}
+
+/// Map the exception in flight to a status.
+asg_status fail_current() noexcept
+{
+    try {
+        throw;
+    } catch (const std::bad_alloc&) {
+        return fail(ASG_ERROR_NO_MEMORY, "out of memory");
+    } catch (const std::invalid_argument& e) {
+        return fail(ASG_ERROR_INVALID, e.what());
+    } catch (const std::exception& e) {
+        return fail(ASG_ERROR_INTERNAL, e.what());
+    } catch (...) {
+        return fail(ASG_ERROR_INTERNAL, "unknown error");
+    }
+}
+
+/// Upper bounds on asg_engine_config fields, far above any real use; a
+/// larger value is a caller bug (e.g. a negative number cast to unsigned)
+/// rather than a request to honour.
+constexpr double max_sample_rate = 1.0e6;
+constexpr std::uint32_t max_threads = 1024;
+constexpr std::uint32_t max_voices = 65536;
+constexpr std::uint32_t max_block = 1u << 20;
+constexpr std::uint32_t max_queue = 1u << 20;
+
+/// Null if `c` is valid; zero fields mean "default" and pass.
+const char* check_config(const asg_engine_config& c) noexcept
+{
+    if (c.sample_rate != 0.0 && !(c.sample_rate > 0.0 && c.sample_rate <= max_sample_rate))
+        return "asg_engine_create: sample_rate must be in (0, 1e6] or 0 for the default";
+    if (c.threads > max_threads)
+        return "asg_engine_create: threads must be at most 1024";
+    if (c.max_voices > max_voices)
+        return "asg_engine_create: max_voices must be at most 65536";
+    if (c.max_block > max_block)
+        return "asg_engine_create: max_block must be at most 1048576";
+    if (c.queue_capacity > max_queue)
+        return "asg_engine_create: queue_capacity must be at most 1048576";
+    return nullptr;
+}
+
+asg::ProceduralToken token_of(const asg_token* t) noexcept
+{
+    asg::ProceduralToken k{t->generator, t->ramp, t->seed, t->length, {}};
+    std::copy(t->params, t->params + ASG_TOKEN_PARAMS, k.params.begin());
+    return k;
+}
+
+} // namespace
+
+struct asg_engine {
+    asg_engine(const asg_engine_config& c)
+        : registry(c.sample_rate != 0.0 ? c.sample_rate : 48000.0),
+          mixer(registry, c.max_voices ? c.max_voices : 32, c.max_block ? c.max_block : 4096),
+          queue(c.queue_capacity ? c.queue_capacity : 256),
+          pool(c.threads ? c.threads : std::max(1u, std::thread::hardware_concurrency()))
+    {
+    }
+
+    asg::ProceduralRegistry registry;
+    asg::ProceduralMixer mixer;
+    asg::SpscQueue<Scheduled> queue;
+    std::atomic<std::uint64_t> position{0};
+    std::atomic<std::uint64_t> dropped{0};
+    asg::ThreadPool pool; // last: joined before the registry goes away
+};
+
+struct asg_batch {
+    std::shared_ptr<asg::TokenBatch> batch;
+};
+
+extern "C" {
+
+uint32_t asg_api_version(void)
+{
+    return ASG_API_VERSION;
+}
+
+const char* asg_last_error(void)
+{
+    return last_error;
+}
+
+asg_status asg_engine_create(const asg_engine_config* config, asg_engine** engine)
+{
+    if (!engine)
+        return fail(ASG_ERROR_INVALID, "asg_engine_create: engine is NULL");
+    *engine = nullptr;
+    // Copy only the fields the caller's struct actually has.
+    asg_engine_config c{};
+    if (config) {
+        if (config->struct_size < offsetof(asg_engine_config, sample_rate))
+            return fail(ASG_ERROR_INVALID, "asg_engine_create: struct_size not set");
+        std::memcpy(&c, config, std::min(config->struct_size, sizeof c));
+    }
+    if (const char* error = check_config(c))
+        return fail(ASG_ERROR_INVALID, error);
+    try {
+        *engine = new asg_engine(c);
+        return ASG_OK;
+    } catch (...) {
+        return fail_current();
+    }
+}
+
+void asg_engine_destroy(asg_engine* engine)
+{
+    delete engine;
+}
+
+asg_status asg_engine_schedule(asg_engine* engine, const asg_token* token, uint64_t at, float gain)
+{
+    if (!engine || !token)
+        return fail(ASG_ERROR_INVALID, "asg_engine_schedule: NULL argument");
+    if (!engine->queue.try_push({token_of(token), at, gain}))
+        return fail(ASG_ERROR_FULL, "asg_engine_schedule: queue full");
+    return ASG_OK;
+}
+
+asg_status asg_engine_render(asg_engine* engine, float* out, size_t frames)
+{
+    if (!engine || (!out && frames))
+        return fail(ASG_ERROR_INVALID, "asg_engine_render: NULL argument");
+    while (const Scheduled* s = engine->queue.front()) {
+        if (!engine->mixer.start(s->token, s->at, s->gain))
+            engine->dropped.fetch_add(1, std::memory_order_relaxed);
+        engine->queue.pop();
+    }
+    engine->mixer.render(out, frames);
+    engine->position.store(engine->mixer.position(), std::memory_order_release);
+    return ASG_OK;
+}
+
+uint64_t asg_engine_position(const asg_engine* engine)
+{
+    return engine ? engine->position.load(std::memory_order_acquire) : 0;
+}
+
+uint64_t asg_engine_dropped(const asg_engine* engine)
+{
+    return engine ? engine->dropped.load(std::memory_order_relaxed) : 0;
+}
+
+asg_status asg_render_token(const asg_engine* engine, const asg_token* token, uint64_t first, float* out, size_t frames)
+{
+    if (!engine || !token || (!out && frames))
+        return fail(ASG_ERROR_INVALID, "asg_render_token: NULL argument");
+    engine->registry.render(token_of(token), first, out, frames);
+    return ASG_OK;
+}
+
+asg_status asg_batch_submit(asg_engine* engine, const asg_token* tokens, float* const* outputs, const size_t* frames,
+                            size_t count, asg_batch** batch)
+{
+    if (!batch)
+        return fail(ASG_ERROR_INVALID, "asg_batch_submit: batch is NULL");
+    *batch = nullptr;
+    if (!engine || (count && (!tokens || !outputs || !frames)))
+        return fail(ASG_ERROR_INVALID, "asg_batch_submit: NULL argument");
+    try {
+        std::vector<asg::ProceduralToken> t(count);
+        std::vector<std::span<float>> o(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!outputs[i] && frames[i])
+                return fail(ASG_ERROR_INVALID, "asg_batch_submit: NULL output");
+            t[i] = token_of(&tokens[i]);
+            o[i] = {outputs[i], frames[i]};
+        }
+        auto handle = std::make_unique<asg_batch>();
+        handle->batch = asg::TokenBatch::submit(engine->pool, engine->registry, std::move(t), std::move(o));
+        *batch = handle.release();
+        return ASG_OK;
+    } catch (...) {
+        return fail_current();
+    }
+}
+
+int asg_batch_done(const asg_batch* batch)
+{
+    return !batch || batch->batch->done();
+}
+
+asg_status asg_batch_wait(asg_batch* batch)
+{
+    if (!batch)
+        return fail(ASG_ERROR_INVALID, "asg_batch_wait: batch is NULL");
+    batch->batch->wait();
+    return ASG_OK;
+}
+
+void asg_batch_release(asg_batch* batch)
+{
+    if (!batch)
+        return;
+    batch->batch->wait();
+    delete batch;
+}
+
+} // extern "C"
@@ -0,0 +1,68 @@
+// Determinism check for the reference set in <asg/determinism.hpp>.
+//
+//     determinism_check check tests/golden/reference.bin
+//     determinism_check record tests/golden/reference.bin
+//
+// `check` renders every case under several thread counts and block sizes,
+// requires them to agree bit for bit, compares the reference render with
+// the golden file, and exits non-zero on any failure. `record` rewrites
+// the golden file from this build; do that only when a generator's output
+// changes on purpose. run_determinism.sh builds this driver for several
+// ISA levels and checks each build. The driver must be compiled with
+// -ffp-contract=off (see <asg/fp_contract.hpp>) and refuses to run
+// otherwise.
+
+#include <asg/determinism.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+int main(int argc, char** argv)
+{
+    if (argc != 3 || (std::strcmp(argv[1], "check") != 0 && std::strcmp(argv[1], "record") != 0)) {
+        std::fprintf(stderr, "usage: %s check|record <golden file>\n", argv[0]);
+        return 2;
+    }
+    if (!asg::fp_contraction_off()) {
+        std::fprintf(stderr, "determinism_check: built with FP contraction; rebuild with -ffp-contract=off\n");
+        return 2;
+    }
+    try {
+        asg::DeterminismHarness h;
+        asg::add_reference_set(h, 48000.0, 0.25);
+        if (std::strcmp(argv[1], "record") == 0) {
+            h.record_golden();
+            h.save_golden(argv[2]);
+            std::printf("recorded %zu cases (%s)\n", h.cases().size(), asg::build_isa());
+            return 0;
+        }
+
+        h.load_golden(argv[2]);
+        std::vector<asg::RenderVariant> variants;
+        for (std::size_t threads : {1, 2, 4})
+            for (std::size_t block : {0, 1, 37, 256, 4096})
+                variants.push_back({threads, block});
+        std::size_t failed = 0, golden = 0;
+        for (const asg::DeterminismResult& r : h.run(variants)) {
+            golden += r.check == "golden";
+            if (r.passed && r.check != "golden")
+                continue;
+            failed += !r.passed;
+            std::printf("%-7s %-18s %-26s max_ulp=%llu", r.passed ? "ok" : "FAIL", r.case_name.c_str(), r.check.c_str(),
+                        static_cast<unsigned long long>(r.max_ulp));
+            if (r.max_ulp)
+                std::printf(" first_mismatch=%zu", r.first_mismatch);
+            std::printf("\n");
+        }
+        if (golden != h.cases().size()) {
+            std::printf("FAIL    golden file covers %zu of %zu cases\n", golden, h.cases().size());
+            ++failed;
+        }
+        std::printf("%s: %zu failure(s) (%s)\n", failed ? "FAILED" : "passed", failed, asg::build_isa());
+        return failed ? 1 : 0;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "determinism_check: %s\n", e.what());
+        return 2;
+    }
+}
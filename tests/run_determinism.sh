@@ -0,0 +1,28 @@
+#!/bin/sh
+# Build tests/determinism_check.cpp at several ISA levels and check each
+# build against the committed golden data. Usage: tests/run_determinism.sh
+# (CXX and CXXFLAGS are honoured). Every build uses -ffp-contract=off, as
+# any build that must reproduce the golden data has to.
+set -eu
+root=$(cd "$(dirname "$0")/.." && pwd)
+out=${TMPDIR:-/tmp}/asg_determinism.$$
+mkdir -p "$out"
+trap 'rm -rf "$out"' EXIT
+cxx=${CXX:-c++}
+
+case $(uname -m) in
+x86_64 | amd64) isas="baseline -mavx2_-mfma -march=native" ;;
+*) isas="baseline -mcpu=native" ;;
+esac
+
+status=0
+for isa in $isas; do
+    flags=$(echo "$isa" | tr '_' ' ')
+    [ "$isa" = baseline ] && flags=
+    echo "== ${isa}"
+    # shellcheck disable=SC2086
+    "$cxx" -std=c++20 -O2 -ffp-contract=off ${CXXFLAGS:-} $flags -I"$root/include" "$root/tests/determinism_check.cpp" \
+        -o "$out/determinism_check" -pthread
+    "$out/determinism_check" check "$root/tests/golden/reference.bin" || status=1
+done
+exit $status